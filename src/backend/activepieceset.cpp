@@ -0,0 +1,46 @@
+#include "activepieceset.h"
+
+void ActivePieceSet::clear(uint32_t seq){
+    active.fill(false);
+    lastSeq = seq;
+    synced = true;
+}
+
+void ActivePieceSet::assign(const QList<uint16_t> &pieces, int64_t seq){
+    active.fill(false);
+    // Set rather than toggled, a piece listed twice is still active
+    for (uint16_t id : pieces) {
+        reserve(id);
+        active.setBit(id);
+    }
+
+    lastSeq = seq;
+    synced = true;
+}
+
+bool ActivePieceSet::applyDelta(const QList<uint16_t> &changed, uint32_t seq){
+    // Deltas can only be applied on top of the update right before them
+    if (!synced || lastSeq < 0 || seq != (uint32_t)(lastSeq + 1)) {
+        synced = false;
+        return false;
+    }
+
+    for (uint16_t id : changed) {
+        reserve(id);
+        active.toggleBit(id);
+    }
+
+    lastSeq = seq;
+    return true;
+}
+
+bool ActivePieceSet::contains(uint16_t id) const{
+    return id < active.size() && active.testBit(id);
+}
+
+void ActivePieceSet::reserve(uint16_t id){
+    // Grow in whole words so the array is rarely reallocated
+    if (id >= active.size()) {
+        active.resize((id / 64 + 1) * 64);
+    }
+}
@@ -0,0 +1,39 @@
+#ifndef ACTIVEPIECESET_H
+#define ACTIVEPIECESET_H
+
+#include <QBitArray>
+#include <QList>
+#include <stdint.h>
+
+// Authoritative set of the pieces that can currently be moved/removed.
+// Stored as a bitset indexed by piece ID so it can be kept up to date with
+// just the pieces that changed since the previous update.
+class ActivePieceSet
+{
+public:
+    // Empties the set, as at the start of a game. seq is the sequence number
+    // of the empty set, so the first delta of the game (seq + 1) applies.
+    void clear(uint32_t seq = 0);
+
+    // Replaces the whole set, seq is the server's sequence number if it sent one
+    void assign(const QList<uint16_t> &pieces, int64_t seq = -1);
+
+    // Toggles the given pieces.
+    // Returns false without changing anything if updates were missed,
+    // in which case a full resync is needed.
+    bool applyDelta(const QList<uint16_t> &changed, uint32_t seq);
+
+    bool contains(uint16_t id) const;
+    bool isSynced() const { return synced; }
+    const QBitArray &bits() const { return active; }
+
+private:
+    QBitArray active;
+    int64_t lastSeq = -1;
+    bool synced = true;
+
+    // Makes room for the ID
+    void reserve(uint16_t id);
+};
+
+#endif // ACTIVEPIECESET_H
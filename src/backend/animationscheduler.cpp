@@ -0,0 +1,172 @@
+#include "animationscheduler.h"
+#include "renderprofiler.h"
+#include <QCoreApplication>
+#include <QDebug>
+#include <algorithm>
+
+AnimationScheduler *AnimationScheduler::instance(){
+    static AnimationScheduler *scheduler = nullptr;
+    if (!scheduler) {
+        scheduler = new AnimationScheduler();
+        // The timer can't outlive the application
+        qAddPostRoutine([]() {
+            delete scheduler;
+            scheduler = nullptr;
+        });
+    }
+    return scheduler;
+}
+
+AnimationScheduler::AnimationScheduler(QObject *parent)
+    : QObject{parent}
+{
+    frameTimer.setTimerType(Qt::PreciseTimer);
+    frameTimer.setInterval(FRAME_INTERVAL);
+    QObject::connect(&frameTimer, &QTimer::timeout, this, &AnimationScheduler::onFrame);
+    clock.start();
+}
+
+
+// ********************************** TWEENS *********************************** //
+void AnimationScheduler::animate(QGraphicsObject *item, Property property, QPointF to, int duration,
+                                 QEasingCurve easing, std::function<void()> finished){
+    add({item, property, value(item, property), to, 0, duration, easing, std::move(finished)});
+}
+
+void AnimationScheduler::animate(QGraphicsObject *item, Property property, qreal to, int duration,
+                                 QEasingCurve easing, std::function<void()> finished){
+    add({item, property, value(item, property), QPointF(to, 0), 0, duration, easing, std::move(finished)});
+}
+
+void AnimationScheduler::add(Tween tween){
+    tween.start = clock.nsecsElapsed();
+    tween.duration = qMax(tween.duration, 1);
+
+    // Replaces the item's running tween of the same property
+    auto running = std::find_if(tweens.begin(), tweens.end(), [&](const Tween &t) {
+        return t.item == tween.item && t.property == tween.property;
+    });
+    if (running != tweens.end()) {
+        *running = std::move(tween);
+    }
+    else {
+        tweens.append(std::move(tween));
+    }
+    peakTweens = qMax(peakTweens, int(tweens.size()));
+
+    if (!frameTimer.isActive()) {
+        totalCost = 0;
+        maxCost = 0;
+        frames = 0;
+        peakTweens = tweens.size();
+        frameTimer.start();
+    }
+}
+
+void AnimationScheduler::stop(QGraphicsObject *item){
+    tweens.removeIf([item](const Tween &t) {
+        return t.item == item;
+    });
+}
+
+bool AnimationScheduler::isAnimating(const QGraphicsObject *item) const{
+    return std::any_of(tweens.cbegin(), tweens.cend(), [item](const Tween &t) {
+        return t.item == item;
+    });
+}
+
+int AnimationScheduler::activeTweens() const{
+    return tweens.size();
+}
+
+void AnimationScheduler::setReporting(bool reporting){
+    this->reporting = reporting;
+}
+
+
+// ********************************** FRAMES *********************************** //
+void AnimationScheduler::onFrame(){
+    RenderProfiler::Scope profile(RenderProfiler::Animation);
+
+    QElapsedTimer cost;
+    cost.start();
+
+    // Progress comes from the clock, so late frames don't slow the tweens down
+    const int64_t now = clock.nsecsElapsed();
+    QList<std::function<void()>> finishedCallbacks;
+
+    for (qsizetype i = 0; i < tweens.size();) {
+        Tween &tween = tweens[i];
+        const qreal progress = qMin(1.0, (now - tween.start) / (tween.duration * 1000000.0));
+        const qreal eased = tween.easing.valueForProgress(progress);
+        apply(tween.item, tween.property, tween.from + (tween.to - tween.from) * eased);
+
+        if (progress < 1) {
+            i++;
+            continue;
+        }
+
+        // Finished tweens are swapped with the last one, the order doesn't matter
+        if (tween.finished) {
+            finishedCallbacks.append(std::move(tween.finished));
+        }
+        if (i != tweens.size() - 1) {
+            tween = std::move(tweens.last());
+        }
+        tweens.removeLast();
+    }
+
+    const int64_t elapsed = cost.nsecsElapsed();
+    totalCost += elapsed;
+    maxCost = qMax(maxCost, elapsed);
+    frames++;
+
+    if (tweens.isEmpty()) {
+        frameTimer.stop();
+        report();
+    }
+
+    // Called last, they may start new tweens or delete their item
+    for (const auto &finished : std::as_const(finishedCallbacks)) {
+        finished();
+    }
+}
+
+void AnimationScheduler::report(){
+    if (!reporting || frames == 0) {
+        return;
+    }
+
+    qDebug().nospace() << "Animation frames: " << frames
+                       << ", avg " << totalCost / frames / 1000 << "us"
+                       << ", max " << maxCost / 1000 << "us"
+                       << ", up to " << peakTweens << " tweens";
+}
+
+
+// ********************************** PROPERTIES *********************************** //
+QPointF AnimationScheduler::value(const QGraphicsObject *item, Property property){
+    switch (property) {
+        case Pos:
+            return item->pos();
+        case Scale:
+            return QPointF(item->scale(), 0);
+        case Opacity:
+            return QPointF(item->opacity(), 0);
+    }
+    return QPointF();
+}
+
+void AnimationScheduler::apply(QGraphicsObject *item, Property property, QPointF value){
+    switch (property) {
+        case Pos:
+            item->setPos(value);
+            break;
+        case Scale:
+            item->setScale(value.x());
+            break;
+        case Opacity:
+            item->setOpacity(value.x());
+            break;
+    }
+}
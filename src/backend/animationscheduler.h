@@ -0,0 +1,86 @@
+#ifndef ANIMATIONSCHEDULER_H
+#define ANIMATIONSCHEDULER_H
+
+#include <QObject>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QEasingCurve>
+#include <QGraphicsObject>
+#include <QPointF>
+#include <QList>
+#include <functional>
+#include <stdint.h>
+
+// Runs the tweens of every item on the board from one frame timer.
+// Each tween moves one property of an item between two values, they're kept
+// side by side in a flat list and advanced together on every tick. The timer
+// only runs while something is animating.
+// Items have to call stop() when they're destroyed. Only used from the GUI
+// thread.
+class AnimationScheduler : public QObject
+{
+    Q_OBJECT
+public:
+    enum Property {
+        Pos,
+        Scale,
+        Opacity
+    };
+
+    // Shared by the whole application, deleted with it
+    static AnimationScheduler *instance();
+
+    // Tweens a property of the item from its current value. An item can only
+    // have one tween per property, a new one takes over from the old one
+    // where it is. finished is called once the end value is reached, not when
+    // the tween is stopped or replaced.
+    void animate(QGraphicsObject *item, Property property, QPointF to, int duration,
+                 QEasingCurve easing = QEasingCurve::Linear, std::function<void()> finished = nullptr);
+    void animate(QGraphicsObject *item, Property property, qreal to, int duration,
+                 QEasingCurve easing = QEasingCurve::Linear, std::function<void()> finished = nullptr);
+
+    // Drops the item's tweens where they are
+    void stop(QGraphicsObject *item);
+    bool isAnimating(const QGraphicsObject *item) const;
+    int activeTweens() const;
+
+    // Logs how long the ticks take after each burst of animations
+    void setReporting(bool reporting);
+
+private:
+    explicit AnimationScheduler(QObject *parent = nullptr);
+
+    const int FRAME_INTERVAL = 16;
+
+    // Scalar properties only use x
+    struct Tween {
+        QGraphicsObject *item;
+        Property property;
+        QPointF from;
+        QPointF to;
+        int64_t start;
+        int duration;
+        QEasingCurve easing;
+        std::function<void()> finished;
+    };
+
+    QList<Tween> tweens;
+    QTimer frameTimer;
+    QElapsedTimer clock;
+
+    // Stats since the timer was started, in ns
+    bool reporting = false;
+    int64_t totalCost = 0;
+    int64_t maxCost = 0;
+    uint32_t frames = 0;
+    int peakTweens = 0;
+
+    void add(Tween tween);
+    void onFrame();
+    void report();
+
+    static QPointF value(const QGraphicsObject *item, Property property);
+    static void apply(QGraphicsObject *item, Property property, QPointF value);
+};
+
+#endif // ANIMATIONSCHEDULER_H
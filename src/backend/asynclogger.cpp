@@ -0,0 +1,275 @@
+#include "asynclogger.h"
+#include <QDateTime>
+#include <chrono>
+#include <string.h>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <errno.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+const char *levelName(QtMsgType type){
+    switch (type) {
+        case QtDebugMsg:
+            return "DEBUG";
+        case QtInfoMsg:
+            return "INFO";
+        case QtWarningMsg:
+            return "WARNING";
+        case QtCriticalMsg:
+            return "CRITICAL";
+        case QtFatalMsg:
+            return "FATAL";
+    }
+    return "DEBUG";
+}
+
+// Async-signal-safe
+void writeAll(int fd, const char *data, size_t size){
+    while (size > 0) {
+#ifdef _WIN32
+        int written = _write(fd, data, (unsigned int)size);
+#else
+        ssize_t written = ::write(fd, data, size);
+        if (written < 0 && errno == EINTR) {
+            continue;
+        }
+#endif
+        if (written <= 0) {
+            return;
+        }
+        data += written;
+        size -= written;
+    }
+}
+
+} // namespace
+
+AsyncLogger::AsyncLogger(const QString &fileName, qint64 maxFileSize, int maxBackups, int capacity)
+{
+    this->fileName = fileName;
+    this->maxFileSize = maxFileSize;
+    this->maxBackups = maxBackups;
+
+    // The capacity has to be a power of two so positions can be masked
+    size_t size = 1;
+    while (size < (size_t)capacity) {
+        size <<= 1;
+    }
+
+    ring.reset(new Slot[size]);
+    mask = size - 1;
+    for (size_t i = 0; i < size; i++) {
+        ring[i].seq.store(i, std::memory_order_relaxed);
+    }
+}
+
+AsyncLogger::~AsyncLogger(){
+    stop();
+}
+
+bool AsyncLogger::start(){
+    if (running) {
+        return true;
+    }
+
+    // Keep the previous runs' logs as backups
+    rotate();
+    if (!openFile()) {
+        return false;
+    }
+
+    running = true;
+    writer = QThread::create([this]{ run(); });
+    writer->setObjectName("AsyncLogger");
+    writer->start(QThread::LowPriority);
+    return true;
+}
+
+void AsyncLogger::stop(){
+    if (!running.exchange(false)) {
+        return;
+    }
+
+    writer->wait();
+    delete writer;
+    writer = nullptr;
+
+    flush();
+    crashFd.store(-1, std::memory_order_relaxed);
+    file.close();
+}
+
+// Bounded MPMC queue (Vyukov): each slot's sequence number tells producers
+// whether it's free for their position and the consumer whether it's filled
+bool AsyncLogger::log(QtMsgType type, const QString &msg){
+    if (!running.load(std::memory_order_relaxed)) {
+        return false;
+    }
+
+    // Formatted before a slot is taken, the drain waits on a taken slot until
+    // it's filled
+    QByteArray line = QDateTime::currentDateTime().toString("yyyy-MM-dd hh:mm:ss.zzz").toUtf8();
+    line += " [";
+    line += levelName(type);
+    line += "] ";
+    line += msg.toUtf8();
+
+    size_t length = line.size();
+    if (length > (size_t)LINE_SIZE - 1) {
+        // Cut at a character boundary, not inside a UTF-8 sequence
+        length = LINE_SIZE - 1;
+        while (length > 0 && (line[length] & 0xc0) == 0x80) {
+            length--;
+        }
+    }
+
+    size_t pos = enqueuePos.load(std::memory_order_relaxed);
+    Slot *slot;
+
+    for (;;) {
+        slot = &ring[pos & mask];
+        size_t seq = slot->seq.load(std::memory_order_acquire);
+        intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+
+        if (diff == 0) {
+            if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                break;
+        }
+        else if (diff < 0) {
+            // The writer hasn't caught up, drop the message rather than block
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        else {
+            pos = enqueuePos.load(std::memory_order_relaxed);
+        }
+    }
+
+    memcpy(slot->line, line.constData(), length);
+    slot->line[length] = '\n';
+    slot->length = length + 1;
+
+    slot->seq.store(pos + 1, std::memory_order_release);
+    return true;
+}
+
+void AsyncLogger::flush(){
+    std::unique_lock<std::timed_mutex> lock(drainMutex, std::chrono::milliseconds(FLUSH_TIMEOUT));
+    if (!lock.owns_lock()) {
+        return;
+    }
+
+    drain();
+    file.flush();
+}
+
+void AsyncLogger::run(){
+    while (running.load(std::memory_order_relaxed)) {
+        bool wrote;
+        {
+            std::lock_guard<std::timed_mutex> lock(drainMutex);
+            wrote = drain();
+        }
+
+        if (!wrote) {
+            QThread::msleep(IDLE_INTERVAL);
+        }
+    }
+}
+
+// Writes everything that's queued as one batch.
+// Must be called with drainMutex held.
+bool AsyncLogger::drain(){
+    QByteArray batch;
+    const size_t first = dequeuePos.load(std::memory_order_relaxed);
+    size_t end = first;
+
+    for (;;) {
+        Slot &slot = ring[end & mask];
+        size_t seq = slot.seq.load(std::memory_order_acquire);
+        if ((intptr_t)seq - (intptr_t)(end + 1) < 0) {
+            break;
+        }
+
+        batch.append(slot.line, slot.length);
+        end++;
+    }
+
+    uint64_t lost = dropped.exchange(0, std::memory_order_relaxed);
+    if (lost > 0) {
+        batch += QDateTime::currentDateTime().toString("yyyy-MM-dd hh:mm:ss.zzz").toUtf8();
+        batch += " [WARNING] Dropped " + QByteArray::number(lost) + " log message(s), the buffer was full\n";
+    }
+
+    if (batch.isEmpty()) {
+        return false;
+    }
+
+    write(batch);
+
+    // Hand the slots back to the producers once their lines are in the file,
+    // until then writeOnCrash() still has them
+    for (size_t pos = first; pos != end; pos++) {
+        ring[pos & mask].seq.store(pos + mask + 1, std::memory_order_release);
+    }
+    dequeuePos.store(end, std::memory_order_release);
+    return true;
+}
+
+void AsyncLogger::write(const QByteArray &batch){
+    if (!file.isOpen()) {
+        return;
+    }
+
+    if (file.size() + batch.size() > maxFileSize) {
+        crashFd.store(-1, std::memory_order_relaxed);
+        file.close();
+        rotate();
+        openFile();
+    }
+
+    // Straight through to the fd, so a crash after this can't lose it
+    file.write(batch);
+    file.flush();
+}
+
+bool AsyncLogger::openFile(){
+    file.setFileName(fileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Append, QFileDevice::WriteUser | QFileDevice::ReadUser)) {
+        return false;
+    }
+    crashFd.store(file.handle(), std::memory_order_relaxed);
+    return true;
+}
+
+// The committed slots the drain hasn't handed back yet. A producer that was
+// interrupted mid-line hasn't committed its slot, it's skipped.
+void AsyncLogger::writeOnCrash(){
+    const int fd = crashFd.load(std::memory_order_relaxed);
+    if (fd < 0) {
+        return;
+    }
+
+    const size_t first = dequeuePos.load(std::memory_order_acquire);
+    const size_t end = enqueuePos.load(std::memory_order_acquire);
+    for (size_t pos = first; pos != end; pos++) {
+        const Slot &slot = ring[pos & mask];
+        if (slot.seq.load(std::memory_order_acquire) == pos + 1) {
+            writeAll(fd, slot.line, slot.length);
+        }
+    }
+}
+
+// log.txt -> log.txt.1 -> log.txt.2 ..., the oldest one is deleted
+void AsyncLogger::rotate(){
+    QFile::remove(QString("%1.%2").arg(fileName).arg(maxBackups));
+    for (int i = maxBackups - 1; i >= 1; i--) {
+        QFile::rename(QString("%1.%2").arg(fileName).arg(i), QString("%1.%2").arg(fileName).arg(i + 1));
+    }
+    QFile::rename(fileName, fileName + ".1");
+}
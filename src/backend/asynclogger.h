@@ -0,0 +1,87 @@
+#ifndef ASYNCLOGGER_H
+#define ASYNCLOGGER_H
+
+#include <QString>
+#include <QFile>
+#include <QThread>
+#include <QtMessageHandler>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <stdint.h>
+
+// Log writer that keeps file I/O off the threads that log.
+// Messages are formatted into lines in a lock-free multi-producer ring buffer
+// and a background thread drains it in batches. The log is rotated by size
+// into numbered backups (log.txt.1 is the newest).
+// The lines sit in preallocated slots, so they can still be written out from
+// a signal handler when the application crashes.
+class AsyncLogger
+{
+public:
+    AsyncLogger(const QString &fileName, qint64 maxFileSize = 4 * 1024 * 1024, int maxBackups = 5, int capacity = 4096);
+    ~AsyncLogger();
+
+    // Rotates the previous log away and starts the writer thread
+    bool start();
+    void stop();
+
+    // Queues a message, never blocks.
+    // Returns false if the buffer is full and the message was dropped.
+    bool log(QtMsgType type, const QString &msg);
+
+    // Writes everything queued so far from the calling thread.
+    // Used when the application is about to die.
+    void flush();
+
+    // Writes the lines not yet in the file straight to it, for signal
+    // handlers. Only async-signal-safe calls: no locks, no allocation.
+    // Lines the writer was in the middle of writing may appear twice.
+    void writeOnCrash();
+
+private:
+    // How long the writer sleeps when there's nothing to write, in ms
+    const int IDLE_INTERVAL = 10;
+
+    // Longer lines are cut short
+    static const int LINE_SIZE = 512;
+
+    struct Slot {
+        std::atomic<size_t> seq;
+        // The formatted line in UTF-8, with its newline
+        uint32_t length;
+        char line[LINE_SIZE];
+    };
+
+    QString fileName;
+    qint64 maxFileSize;
+    int maxBackups;
+
+    std::unique_ptr<Slot[]> ring;
+    size_t mask;
+
+    // Producers and the consumer touch different cache lines
+    alignas(64) std::atomic<size_t> enqueuePos{0};
+    // Only moved past a slot once its line is in the file.
+    // Atomic for writeOnCrash(), only the drain stores it.
+    alignas(64) std::atomic<size_t> dequeuePos{0};
+    std::atomic<uint64_t> dropped{0};
+    std::atomic<bool> running{false};
+
+    // Only one thread drains at a time (the writer, or flush() on a crash).
+    // flush() gives up after a while in case the writer itself crashed mid-drain.
+    const int FLUSH_TIMEOUT = 200;
+    std::timed_mutex drainMutex;
+    QThread *writer = nullptr;
+    QFile file;
+    // The file's descriptor for writeOnCrash(), -1 while it's closed
+    std::atomic<int> crashFd{-1};
+
+    void run();
+    bool drain();
+    void write(const QByteArray &batch);
+    bool openFile();
+    void rotate();
+};
+
+#endif // ASYNCLOGGER_H
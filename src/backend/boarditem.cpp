@@ -0,0 +1,129 @@
+#include "boarditem.h"
+#include "spritecache.h"
+#include "renderprofiler.h"
+#include "tracer.h"
+#include <QPainter>
+#include <QPaintDevice>
+#include <QStyleOptionGraphicsItem>
+#include <QGraphicsSceneMouseEvent>
+#include <QtMath>
+
+
+BoardItem::BoardItem(const BoardTopology &topology, float gridSpacing, float radius, QPen linesPen, QPen nodesPen, QBrush nodesBrush)
+{
+    this->gridSpacing = gridSpacing;
+    this->radius = radius;
+    this->linesPen = linesPen;
+    this->nodesPen = nodesPen;
+    this->nodesBrush = nodesBrush;
+
+    // Links listed from both ends are only kept from the end that comes first
+    auto comesFirst = [](QPoint a, QPoint b) {
+        return a.y() != b.y() ? a.y() < b.y() : a.x() < b.x();
+    };
+
+    QPoint topLeft, bottomRight;
+    for (auto i = topology.cbegin(), end = topology.cend(); i != end; ++i) {
+        QPoint node = i.key();
+        nodes.append(node);
+
+        for (const QPoint &neighbor : i.value()) {
+            if (comesFirst(node, neighbor) || !topology.value(neighbor).contains(node)) {
+                links.append(QLineF(QPointF(node) * gridSpacing, QPointF(neighbor) * gridSpacing));
+            }
+        }
+
+        topLeft = nodes.size() == 1 ? node : QPoint(qMin(topLeft.x(), node.x()), qMin(topLeft.y(), node.y()));
+        bottomRight = nodes.size() == 1 ? node : QPoint(qMax(bottomRight.x(), node.x()), qMax(bottomRight.y(), node.y()));
+    }
+
+    // Whole pixels around the outermost nodes and their outlines, so the
+    // cache lines up with the screen's pixels
+    const float margin = radius + qMax(linesPen.widthF(), nodesPen.widthF()) / 2 + 1;
+    bounds = QRectF(QPointF(topLeft) * gridSpacing, QPointF(bottomRight) * gridSpacing)
+                 .adjusted(-margin, -margin, margin, margin).toAlignedRect();
+
+    // Under the pieces, and only the exposed part is repainted
+    setZValue(-1);
+    setFlag(QGraphicsItem::ItemUsesExtendedStyleOption);
+}
+
+QPoint BoardItem::nodeAt(QPointF pos) const{
+    QPoint nearest(qRound(pos.x() / gridSpacing), qRound(pos.y() / gridSpacing));
+    QPointF offset = pos - QPointF(nearest) * gridSpacing;
+
+    if (QPointF::dotProduct(offset, offset) > radius * radius || !nodes.contains(nearest))
+        return QPoint(-1, -1);
+
+    return nearest;
+}
+
+
+// ********************************** OVERLOADS *********************************** //
+QRectF BoardItem::boundingRect() const{
+    return bounds;
+}
+
+void BoardItem::paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget){
+    RenderProfiler::Scope profile(RenderProfiler::BoardPaint);
+    Tracer::Scope trace("BoardItem::paint", "paint");
+
+    // A scaled or rotated view would blur the pixmap
+    if (!SpriteCache::isEnabled() || painter->worldTransform().type() > QTransform::TxTranslate) {
+        render(painter);
+        return;
+    }
+
+    const qreal pixelRatio = painter->device()->devicePixelRatio();
+    if (cache.isNull() || cache.devicePixelRatio() != pixelRatio) {
+        cache = QPixmap((bounds.size() * pixelRatio).toSize());
+        cache.setDevicePixelRatio(pixelRatio);
+        cache.fill(Qt::transparent);
+
+        QPainter cachePainter(&cache);
+        cachePainter.setRenderHint(QPainter::Antialiasing);
+        cachePainter.translate(-bounds.topLeft());
+        render(&cachePainter);
+    }
+
+    const QRectF exposed = option->exposedRect & bounds;
+    const QRectF source((exposed.topLeft() - bounds.topLeft()) * pixelRatio, exposed.size() * pixelRatio);
+    painter->drawPixmap(exposed, cache, source);
+}
+
+void BoardItem::render(QPainter *painter) const{
+    painter->setPen(linesPen);
+    painter->drawLines(links);
+
+    SpriteCache::Circle circle;
+    circle.fill = nodesBrush.color();
+    circle.outline = nodesPen.color();
+    circle.outlineWidth = nodesPen.widthF();
+    circle.radius = radius;
+
+    for (const QPoint &node : nodes) {
+        painter->save();
+        painter->translate(QPointF(node) * gridSpacing);
+        SpriteCache::render(painter, circle);
+        painter->restore();
+    }
+}
+
+
+// ********************************** EVENT HANDLERS ******************************** //
+// Only presses on a node are taken, so the release comes back here
+void BoardItem::mousePressEvent(QGraphicsSceneMouseEvent *event){
+    if (nodeAt(event->pos()) == QPoint(-1, -1)) {
+        event->ignore();
+        return;
+    }
+    event->accept();
+}
+
+void BoardItem::mouseReleaseEvent(QGraphicsSceneMouseEvent *event) {
+    QPoint node = nodeAt(event->pos());
+    if (node != QPoint(-1, -1)) {
+        emit nodeClicked(node);
+    }
+    QGraphicsObject::mouseReleaseEvent(event);
+}
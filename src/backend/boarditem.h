@@ -0,0 +1,54 @@
+#ifndef BOARDITEM_H
+#define BOARDITEM_H
+
+#include <QGraphicsObject>
+#include <QObject>
+#include <QPixmap>
+#include <QPen>
+#include <QBrush>
+#include <QLineF>
+#include "protocol.h"
+
+// The static part of the board, its links and nodes, as a single item.
+// Each link is drawn once even though the topology lists it from both ends.
+// The whole board is rendered into a pixmap for the screen's pixel ratio and
+// repaints copy the part of it that's exposed.
+// Clicks are matched to the nearest node by position, the nodes aren't
+// items of their own.
+class BoardItem : public QGraphicsObject
+{
+    Q_OBJECT
+public:
+    BoardItem(const BoardTopology &topology, float gridSpacing, float radius, QPen linesPen, QPen nodesPen, QBrush nodesBrush);
+
+    // Board coordinates of the node under a point in item coordinates,
+    // (-1, -1) if there's none
+    QPoint nodeAt(QPointF pos) const;
+
+    QRectF boundingRect() const;
+    void paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget);
+
+signals:
+    void nodeClicked(QPoint boardPos);
+
+private:
+    float gridSpacing;
+    float radius;
+    QPen linesPen;
+    QPen nodesPen;
+    QBrush nodesBrush;
+
+    QList<QLineF> links;
+    QList<QPoint> nodes;
+    QRectF bounds;
+    QPixmap cache;
+
+    // Draws the board directly, it's also how the cache is made
+    void render(QPainter *painter) const;
+
+    // Event Handlers
+    void mousePressEvent(QGraphicsSceneMouseEvent *event);
+    void mouseReleaseEvent(QGraphicsSceneMouseEvent *event);
+ };
+
+#endif // BOARDITEM_H
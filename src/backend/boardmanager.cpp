@@ -1,9 +1,41 @@
 #include "boardmanager.h"
+#include "renderprofiler.h"
+#include "tracer.h"
 #include <stdio.h>
-#include <QJsonDocument>
-#include <QJsonObject>
-#include <QJsonArray>
-#include <QJsonValue>
+
+namespace {
+
+Rules::Geometry geometryOf(const BoardTopology &topology, std::string *error){
+    std::vector<Rules::NodeLinks> nodes;
+    nodes.reserve(topology.size());
+
+    for (auto it = topology.constBegin(); it != topology.constEnd(); ++it) {
+        Rules::NodeLinks node;
+        node.point = {it.key().x(), it.key().y()};
+        for (const QPoint &neighbor : it.value()) {
+            node.neighbors.push_back({neighbor.x(), neighbor.y()});
+        }
+        nodes.push_back(node);
+    }
+
+    Rules::Geometry geometry;
+    geometry.build(nodes, error);
+    return geometry;
+}
+
+Rules::Phase phaseOf(const QString &state){
+    if (state == "PLACEMENT")
+        return Rules::Phase::Placement;
+    if (state == "FIRST_REMOVAL")
+        return Rules::Phase::FirstRemoval;
+    if (state == "REMOVAL")
+        return Rules::Phase::Removal;
+    if (state == "MOVEMENT")
+        return Rules::Phase::Movement;
+    return Rules::Phase::Over;
+}
+
+} // namespace
 
 BoardManager::BoardManager(QSettings *settings, QObject *parent)
     : QObject{parent}
@@ -11,126 +43,192 @@ BoardManager::BoardManager(QSettings *settings, QObject *parent)
     gameState = GameState::STOPPED;
     this->settings = settings;
 
-    // Opens websocket connection to shax server
-    mode = settings->value("mode", "Remote").toString();
+    // Answers requests itself when playing the CPU offline
+    localGame = new LocalGame(this);
+
+    loadSettings();
     this->url = QUrl(settings->value("url", "ws://localhost:8765").toString());
-    this->lobbyKey = settings->value("lobby_key", 0).toUInt();
+
+    // Everything created by the worker from here on lives on its thread
+    worker = new ProtocolWorker(&latency);
+    worker->moveToThread(&workerThread);
+    QObject::connect(&workerThread, &QThread::finished, worker, &QObject::deleteLater);
+    workerThread.setObjectName("ProtocolWorker");
+    workerThread.start();
 
     // Connects all signals and slots
     connectSignals();
+
+    // Opens the websocket connection to the shax server.
+    // It's kept open across games and only reopened when the url changes.
+    QMetaObject::invokeMethod(worker, [worker = worker, url = url, mode = mode, binary = binaryProtocol, delta = activeDelta]{
+        worker->configure(mode, binary, delta);
+        worker->init(url);
+    });
 }
 
 // Closes websocket connection before deleting
 BoardManager::~BoardManager(){
-    websocket.close(QWebSocketProtocol::CloseCodeAbnormalDisconnection);
-    qDebug() << "Closing connection";
+    QMetaObject::invokeMethod(worker, &ProtocolWorker::shutdown, Qt::BlockingQueuedConnection);
+    workerThread.quit();
+    workerThread.wait();
+
+    // Keep the latencies of this session for later comparison
+    QString latencyFile = settings->value("debug/latency_file", "latency.txt").toString();
+    if (!latencyFile.isEmpty() && !latency.dump(latencyFile)) {
+        qWarning() << "Couldn't write the latencies to" << latencyFile;
+    }
 }
 
 void BoardManager::connectSignals(){
-    QObject::connect(&websocket, &QWebSocket::connected, this, &BoardManager::onConnected);
-    QObject::connect(&websocket, &QWebSocket::textMessageReceived, this, &BoardManager::onTextMessageReceived);
-    QObject::connect(&websocket, &QWebSocket::errorOccurred, this, &BoardManager::error);
+    QObject::connect(worker, &ProtocolWorker::connected, this, &BoardManager::onConnected);
+    QObject::connect(worker, &ProtocolWorker::disconnected, this, &BoardManager::onDisconnected);
+    QObject::connect(worker, &ProtocolWorker::connectionError, this, &BoardManager::connectionError);
+    QObject::connect(worker, &ProtocolWorker::connectionInterrupted, this, &BoardManager::onConnectionInterrupted);
+    QObject::connect(worker, &ProtocolWorker::requestCompleted, this, &BoardManager::onRequestCompleted);
+
+    QObject::connect(worker, &ProtocolWorker::joinGameReceived, this, &BoardManager::startGameResponseHandler);
+    QObject::connect(worker, &ProtocolWorker::placePieceReceived, this, &BoardManager::placePieceResponseHandler);
+    QObject::connect(worker, &ProtocolWorker::removePieceReceived, this, &BoardManager::removePieceResponseHandler);
+    QObject::connect(worker, &ProtocolWorker::movePieceReceived, this, &BoardManager::movePieceResponseHandler);
+    QObject::connect(worker, &ProtocolWorker::quitGameReceived, this, &BoardManager::quitGameResponseHandler);
+    QObject::connect(worker, &ProtocolWorker::syncActiveReceived, this, &BoardManager::syncActiveResponseHandler);
+    QObject::connect(worker, &ProtocolWorker::resumeGameReceived, this, &BoardManager::resumeGameResponseHandler);
+
+    QObject::connect(localGame, &LocalGame::requestCompleted, this, &BoardManager::onRequestCompleted);
+    QObject::connect(localGame, &LocalGame::joinGameReceived, this, &BoardManager::startGameResponseHandler);
+    QObject::connect(localGame, &LocalGame::placePieceReceived, this, &BoardManager::placePieceResponseHandler);
+    QObject::connect(localGame, &LocalGame::removePieceReceived, this, &BoardManager::removePieceResponseHandler);
+    QObject::connect(localGame, &LocalGame::movePieceReceived, this, &BoardManager::movePieceResponseHandler);
+    QObject::connect(localGame, &LocalGame::quitGameReceived, this, &BoardManager::quitGameResponseHandler);
+    QObject::connect(localGame, &LocalGame::syncActiveReceived, this, &BoardManager::syncActiveResponseHandler);
 }
 
-void BoardManager::sendMessage(QJsonObject msg){
-    if(status){
-        QString msgStr = dumpJson(msg);
-        websocket.sendTextMessage(msgStr);
+// Tags a request with an ID and hands it to the worker.
+// It's sent as soon as the connection is up and there's room in flight,
+// so requests can be issued back to back without waiting on each response.
+uint32_t BoardManager::sendRequest(QCborMap msg, ResponseCallback callback){
+    uint32_t id = nextRequestId++;
+    msg["request_id"] = (qint64)id;
+
+    if (callback) {
+        callbacks.insert(id, callback);
     }
-    else
-        qDebug() << "Not connected to the server yet\n";
+
+    // Queued so offline responses arrive after the caller returns, like the server's
+    if (offline) {
+        QMetaObject::invokeMethod(localGame, [localGame = localGame, id, msg]{
+            localGame->handleRequest(id, msg);
+        }, Qt::QueuedConnection);
+        return id;
+    }
+
+    QMetaObject::invokeMethod(worker, [worker = worker, id, msg]{
+        worker->sendRequest(id, msg);
+    });
+
+    return id;
 }
 
-void BoardManager::reconnect(){
+// Loads the settings used when starting a game
+void BoardManager::loadSettings(){
     this->mode = settings->value("mode", "Remote").toString();
-    this->url = QUrl(settings->value("url", "ws://localhost:8765").toString());
     this->lobbyKey = settings->value("lobby_key", 0).toUInt();
-
-    websocket.open(url);
-    qDebug() << "Attempting to reconnect...";
+    this->binaryProtocol = settings->value("binary_protocol", true).toBool();
+    this->activeDelta = settings->value("active_delta", true).toBool();
+    this->prediction = settings->value("prediction", true).toBool();
+
+    this->offline = mode == "CPU" && settings->value("engine/offline", true).toBool();
+    localGame->setMoveTime(settings->value("engine/move_time_ms", 1000).toInt());
+    localGame->setHumanSide(settings->value("engine/human_side", 0).toUInt() & 1);
+    localGame->setHashSize(settings->value("engine/tt_mb", 16).toInt());
+    localGame->setThreads(qMax(1, settings->value("engine/threads", QThread::idealThreadCount()).toInt()));
+    localGame->setTablebasePath(settings->value("engine/tablebase_dir", "tablebases").toString());
+    localGame->setBookPath(settings->value("engine/book_file", "book.shbk").toString());
 }
 
-// ******************** JSON HELPER FUNCTIONS ***************************** //
+// Starts a game right away if already connected, otherwise once the connection opens
+void BoardManager::requestGame(){
+    loadSettings();
+    gameRequestTimer.start();
 
-QJsonObject BoardManager::loadJson(QString msg){
-    QJsonDocument response = QJsonDocument::fromJson(msg.toUtf8());
-    return response.object();
-}
-QString BoardManager::dumpJson(QJsonObject msg){
-    return QJsonDocument(msg).toJson(QJsonDocument::Compact);
-}
+    // Nothing to connect to
+    if (offline) {
+        connectionReused = true;
+        startGame();
+        return;
+    }
 
+    QMetaObject::invokeMethod(worker, [worker = worker, mode = mode, binary = binaryProtocol, delta = activeDelta]{
+        worker->configure(mode, binary, delta);
+    });
 
-// ********************* WEBSOCKET-RELATED SLOTS **************************** //
-void BoardManager::onConnected(){
-    status = true;
-    emit connected();
-}
+    if (status) {
+        connectionReused = true;
+        startGame();
+        return;
+    }
 
-void BoardManager::onTextMessageReceived(const QString &msg){
-    qDebug() << "Got a response.";
+    // The request is sent once the connection opens
+    connectionReused = false;
+    pendingStart = true;
+    startGame();
+    QMetaObject::invokeMethod(worker, &ProtocolWorker::ensureConnected);
+}
 
-    QJsonObject data = loadJson(msg);
+// Reopens the connection if the server url setting has changed
+void BoardManager::updateUrl(){
+    QUrl newUrl(settings->value("url", "ws://localhost:8765").toString());
 
-    // Get the current action of the
-    QString action = "";
-    if(const QJsonValue v = data["action"]; v.isString()){
-        action = v.toString();
+    if (newUrl == url) {
+        return;
     }
 
-    if (action == "join_game")
-        startGameResponseHandler(data);
-    else if(action == "place_piece")
-        placePieceResponseHandler(data);
-    else if(action == "remove_piece")
-        removePieceResponseHandler(data);
-    else if(action == "move_piece")
-        movePieceResponseHandler(data);
-    else if(action == "quit_game")
-        quitGameResponseHandler(data);
-    else
-        qDebug() << "Received unexpected action:" << action << "\n";
+    url = newUrl;
+    QMetaObject::invokeMethod(worker, [worker = worker, url = url]{
+        worker->setUrl(url);
+    });
 }
 
-void BoardManager::error(QAbstractSocket::SocketError error){
-    qDebug() << "An error has occured:" << error << "\n";
+void BoardManager::reconnect(){
+    status = false;
+    QMetaObject::invokeMethod(worker, &ProtocolWorker::reconnect);
+}
 
-    // Create an artificial API response to properly end the current game
-    if (status) {
-        QJsonObject data;
-        data["success"] = true;
-        data["error"] = "";
-        data["winner"] = 0;
-        data["forfeit"] = true;
-        quitGameResponseHandler(data);
-    }
 
+// ************************** WORKER EVENTS ******************************* //
+void BoardManager::onConnected(){
+    status = true;
+    pendingStart = false;
+    emit connected();
+}
+
+void BoardManager::onDisconnected(){
     status = false;
-    running = false;
-    waiting = false;
+}
 
-    // Handles a lost connection
-    if (error == QAbstractSocket::RemoteHostClosedError) {
-        emit connectionError("Lost the connection to the websocket server. Check your connection and try again.");
+void BoardManager::onConnectionInterrupted(){
+    resuming = true;
+    emit connectionInterrupted();
+}
 
+void BoardManager::onRequestCompleted(uint32_t id, QCborMap response, int64_t receivedAt){
+    ResponseCallback callback = callbacks.take(id);
+    if (callback) {
+        callback(response);
     }
-    else if (error == QAbstractSocket::ConnectionRefusedError){
-        emit connectionError("Couldn't connect to the websocket server.");
-    }
-    else {
-        emit connectionError("An error occured with the connection to the server.");
-    }
-
 
+    // Time from the response's arrival until the GUI thread was done with it
+    latency.record(response.value("action").toString() + "/handling", (LatencyStats::now() - receivedAt) / 1000);
 }
 
 
 // *************************** GAME MOVES ********************************** //
-void BoardManager::startGame(){
+void BoardManager::startGame(ResponseCallback callback){
     qDebug() << "Attempting to start a game.";
 
-    // Build the json message
-    QJsonObject data;
+    // Build the message, the worker adds the handshake options
+    QCborMap data;
     data["action"] = "join_game";
 
     if(mode == "Online") {
@@ -153,53 +251,156 @@ void BoardManager::startGame(){
     }
 
     // Send the message
-    sendMessage(data);
+    sendRequest(data, callback);
 }
 
-void BoardManager::placePiece(uint8_t x, uint8_t y){
+bool BoardManager::placePiece(uint8_t x, uint8_t y, ResponseCallback callback){
     qDebug() << "Attempting to place a piece.";
 
-    QJsonObject data;
+    if (!showPrediction(canPredict() ? predictor.place(QPoint(x, y)) : std::nullopt)) {
+        return false;
+    }
+
+    QCborMap data;
     data["action"] = "place_piece";
     data["x"] = x;
     data["y"] = y;
 
-    sendMessage(data);
+    sendRequest(data, callback);
+    return true;
 }
 
-void BoardManager::removePiece(uint16_t pieceId){
+bool BoardManager::removePiece(uint16_t pieceId, ResponseCallback callback){
     qDebug() << "Attempting to remove a piece.";
 
-    QJsonObject data;
+    // The server doesn't know about pieces it hasn't confirmed yet
+    if (predictor.isTemporary(pieceId)) {
+        return false;
+    }
+
+    if (!showPrediction(canPredict() ? predictor.remove(pieceId) : std::nullopt)) {
+        return false;
+    }
+
+    QCborMap data;
     data["action"] = "remove_piece";
     data["piece_ID"] = pieceId;
 
-    sendMessage(data);
+    sendRequest(data, callback);
+    return true;
 }
 
-void BoardManager::movePiece(uint16_t pieceId, uint8_t x, uint8_t y){
+bool BoardManager::movePiece(uint16_t pieceId, uint8_t x, uint8_t y, ResponseCallback callback){
     qDebug() << "Attempting to move a piece.";
 
-    QJsonObject data;
+    // The server doesn't know about pieces it hasn't confirmed yet
+    if (predictor.isTemporary(pieceId)) {
+        return false;
+    }
+
+    if (!showPrediction(canPredict() ? predictor.move(pieceId, QPoint(x, y)) : std::nullopt)) {
+        return false;
+    }
+
+    QCborMap data;
     data["action"] = "move_piece";
     data["piece_ID"] = pieceId;
     data["new_x"] = x;
     data["new_y"] = y;
 
-    sendMessage(data);
+    sendRequest(data, callback);
+    return true;
 }
 
 void BoardManager::quitGame(){
     qDebug() << "Attempting to end a game.";
 
-    QJsonObject data;
+    QCborMap data;
     data["action"] = "quit_game";
 
-    sendMessage(data);
+    sendRequest(data);
+}
+
+
+// ***************************** PREDICTION ******************************* //
+
+// Whether the local player's next move can be applied before the server answers
+bool BoardManager::canPredict() const{
+    bool localTurn = mode == "Local" || predictor.predicted().side == playerNum;
+    return prediction && running && predictor.isActive() && localTurn;
+}
+
+// Shows a predicted move right away.
+// Returns false if the move shouldn't be sent at all.
+bool BoardManager::showPrediction(const std::optional<MovePredictor::Prediction> &prediction){
+    if (!prediction) {
+        // Moves made on top of unconfirmed ones can only be judged by the engine
+        if (predictor.hasPending()) {
+            qDebug() << "Not sending a move that isn't legal after the predicted ones.";
+            return false;
+        }
+        return true;
+    }
+
+    // Only highlight pieces if it's still the local player's turn
+    emit movePredicted(*prediction, canPredict() ? predictor.activePieces() : QBitArray());
+    return true;
+}
+
+void BoardManager::resolvePrediction(MovePredictor::Outcome outcome, const MovePredictor::Prediction &confirmed, const QList<MovePredictor::Prediction> &rolledBack, uint16_t pieceId){
+    if (outcome == MovePredictor::Confirmed && confirmed.move.type() == Rules::Move::Place) {
+        emit predictionConfirmed(confirmed, pieceId);
+    }
+
+    if (!rolledBack.isEmpty()) {
+        qDebug() << "Rolling back" << rolledBack.size() << "predicted move(s).";
+    }
+    for (const MovePredictor::Prediction &prediction : rolledBack) {
+        emit predictionRolledBack(prediction);
+    }
+}
+
+GameState BoardManager::expectedState() const{
+    if (!predictor.hasPending()) {
+        return gameState;
+    }
+
+    switch (predictor.predicted().phase) {
+        case Rules::Phase::Placement:
+            return GameState::PLACEMENT;
+        case Rules::Phase::FirstRemoval:
+            return GameState::FIRST_REMOVAL;
+        case Rules::Phase::Removal:
+            return GameState::REMOVAL;
+        case Rules::Phase::Movement:
+            return GameState::MOVEMENT;
+        default:
+            return GameState::STOPPED;
+    }
 }
 
 
 // *************************** RESPONSE HANDLERS **************************** //
+
+// Applies the full list or the delta of the active pieces sent with a move
+template<typename Response>
+void BoardManager::updateActivePieces(const Response &response){
+    if (response.has(Response::Field_activePieces)) {
+        activePieces.assign(response.activePieces, response.has(Response::Field_activeSeq) ? (int64_t)response.activeSeq : -1);
+    }
+    else if (response.has(Response::Field_activeChanged)) {
+        bool wasSynced = activePieces.isSynced();
+
+        // Ask for the full set once if an update was missed
+        if (!activePieces.applyDelta(response.activeChanged, response.activeSeq) && wasSynced) {
+            qDebug() << "Missed an update to the active pieces, requesting a resync.";
+
+            QCborMap data;
+            data["action"] = "sync_active";
+            sendRequest(data);
+        }
+    }
+}
 void BoardManager::setState(QString s){
     if(s == "STOPPED")
         gameState = GameState::STOPPED;
@@ -215,176 +416,175 @@ void BoardManager::setState(QString s){
         qDebug() << "Unknown game state: "<< s << "\n";
 }
 
-void BoardManager::startGameResponseHandler(QJsonObject &data){
-    try {
-        // Load the response values
-        bool success = data["success"].toBool();
-        QString error = data["error"].toString();
-        bool isWaiting = data["waiting"].toBool();
-        int num = data["player_num"].toInt();
-        uint64_t lobbyKey = data["lobby_key"].toInteger();
-        QString nextState = data["next_state"].toString();
-        int nextPlayer = data["next_player"].toInt();
-
-        // Load the adjacent pieces
-        QHash<QPoint, QList<QPoint>> adjacentPieces;
-
-        // Add each of the nodes to the adjacent pieces map
-        const QJsonArray nodes = data["adjacent_pieces"].toArray();
-        for (const auto& node: nodes) {
-
-            // Create a list out of all the node's neighboring points
-            QList<QPoint> neighborPoints;
-            const QJsonArray neighbors = node.toObject()["neighbors"].toArray();
-            for (const auto& neighbor: neighbors) {
-                int x = neighbor.toObject()["x"].toInt();
-                int y = neighbor.toObject()["y"].toInt();
-
-                neighborPoints.append(QPoint(x, y));
-            }
-
-            // Add the node to the adjacentPieces map with its neighbors as its value
-            int x = node.toObject()["x"].toInt();
-            int y = node.toObject()["y"].toInt();
-            adjacentPieces.insert(QPoint(x, y), neighborPoints);
-        }
+void BoardManager::startGameResponseHandler(const Protocol::JoinGameResponse &response){
+    RenderProfiler::Scope profile(RenderProfiler::Protocol);
+    Tracer::Scope trace("BoardManager::startGameResponseHandler", "protocol");
+    if (gameRequestTimer.isValid()) {
+        qDebug() << "Got a join_game response" << gameRequestTimer.elapsed() << "ms after the request"
+                 << (connectionReused ? "(reused connection)" : "(new connection)");
+        gameRequestTimer.invalidate();
+    }
 
-        // Check if the game started successfully
-        if (success) {
-            running = true;
-            this->totalPieces[0] = 0;
-            this->totalPieces[1] = 0;
+    emit protocolEventReceived();
+
+    // Check if the game started successfully.
+    // The worker has already resolved the board layout from the cache.
+    if (response.success) {
+        running = true;
+        this->totalPieces[0] = 0;
+        this->totalPieces[1] = 0;
+        // Deltas follow on from the empty set the game starts with
+        activePieces.clear(response.has(Protocol::JoinGameResponse::Field_activeSeq) ? response.activeSeq : 0);
+
+        std::string error;
+        geometry = geometryOf(response.adjacentPieces, &error);
+        if (!error.empty()) {
+            qWarning() << "The board can't be used by the rules engine:" << QString::fromStdString(error);
+            predictor.stop();
         }
+        else {
+            qDebug() << "Board has" << geometry.nodeCount() << "nodes and" << geometry.mills().size() << "mills";
+            predictor.reset(geometry, phaseOf(response.nextState), response.nextPlayer);
+        }
+    }
 
-        // Update the game state
-        setState(nextState);
-        waiting = isWaiting;
-        playerNum = num;
-        currentTurn = nextPlayer;
-        this->lobbyKey = lobbyKey;
-
-        emit startGameResponded(success, error, isWaiting, lobbyKey, nextState, nextPlayer, adjacentPieces);
+    // Update the game state
+    setState(response.nextState);
+    waiting = response.waiting;
+    playerNum = response.playerNum;
+    currentTurn = response.nextPlayer;
+    this->lobbyKey = response.lobbyKey;
 
-    } catch (...) {
-        qDebug() << "Received an unexpected response.\n";
-    }
+    emit startGameResponded(response.success, response.error, response.waiting, response.lobbyKey, response.nextState, response.nextPlayer, response.adjacentPieces, response.topologyHash);
 }
 
-void BoardManager::placePieceResponseHandler(QJsonObject &data){
-    try {
-        // Move-independent parameters
-        bool success = data["success"].toBool();
-        QString error = data["error"].toString();
-        int nextPlayer = data["next_player"].toInt();
-        QString nextState = data["next_state"].toString();
+void BoardManager::placePieceResponseHandler(const Protocol::PlacePieceResponse &response){
+    RenderProfiler::Scope profile(RenderProfiler::Protocol);
+    Tracer::Scope trace("BoardManager::placePieceResponseHandler", "protocol");
+    emit protocolEventReceived();
 
-        // Placement related parameters
-        uint16_t newId = data["new_piece_ID"].toInt();
-        uint8_t x = data["new_x"].toInt();
-        uint8_t y = data["new_y"].toInt();
+    // Check the move against the one that was predicted for it
+    MovePredictor::Prediction confirmed;
+    QList<MovePredictor::Prediction> rolledBack;
+    MovePredictor::Outcome outcome = predictor.placed(response.success, response.newPieceId, QPoint(response.x, response.y), phaseOf(response.nextState), response.nextPlayer, &confirmed, &rolledBack);
+    resolvePrediction(outcome, confirmed, rolledBack, response.newPieceId);
 
-        QList<uint16_t> activePieces;
-        for (const auto& piece: data["active_pieces"].toArray()) {
-            activePieces.append(piece.toInt());
-        }
+    // Update the number of pieces
+    if(response.success) {
+        totalPieces[currentTurn] += 1;
+    }
 
-        // Update the number of pieces
-        if(success) {
-            totalPieces[currentTurn] += 1;
-        }
+    updateActivePieces(response);
 
-        // Notify the UI of the move's result
-        emit placePieceResponded(success, error, newId, x, y, nextState, nextPlayer, activePieces);
+    // Notify the UI of the move's result
+    emit placePieceResponded(response.success, response.error, response.newPieceId, response.x, response.y, response.nextState, response.nextPlayer, activePieces.bits());
 
-        // Update the game state
-        setState(nextState);
-        currentTurn = nextPlayer;
+    // Update the game state
+    setState(response.nextState);
+    currentTurn = response.nextPlayer;
+}
 
-    } catch (...) {
-        qDebug() << "Received an unexpected response.\n";
+void BoardManager::removePieceResponseHandler(const Protocol::RemovePieceResponse &response){
+    RenderProfiler::Scope profile(RenderProfiler::Protocol);
+    Tracer::Scope trace("BoardManager::removePieceResponseHandler", "protocol");
+    emit protocolEventReceived();
+
+    // Check the move against the one that was predicted for it
+    QList<MovePredictor::Prediction> rolledBack;
+    MovePredictor::Outcome outcome = predictor.removed(response.success, response.removedPiece, phaseOf(response.nextState), response.nextPlayer, &rolledBack);
+    resolvePrediction(outcome, MovePredictor::Prediction(), rolledBack, response.removedPiece);
+
+    // Update the number of pieces
+    if(response.success) {
+        totalPieces[(currentTurn + 1) % 2] -= 1;
     }
 
+    updateActivePieces(response);
+
+    // Notify the UI of the move's result
+    emit removePieceResponded(response.success, response.error, response.removedPiece, response.nextState, response.nextPlayer, activePieces.bits());
+
+    // Update the game state
+    setState(response.nextState);
+    currentTurn = response.nextPlayer;
 }
 
-void BoardManager::removePieceResponseHandler(QJsonObject &data){
-    try {
-        // Move-independent parameters
-        bool success = data["success"].toBool();
-        QString error = data["error"].toString();
-        int nextPlayer = data["next_player"].toInt();
-        QString nextState = data["next_state"].toString();
+void BoardManager::movePieceResponseHandler(const Protocol::MovePieceResponse &response){
+    RenderProfiler::Scope profile(RenderProfiler::Protocol);
+    Tracer::Scope trace("BoardManager::movePieceResponseHandler", "protocol");
+    emit protocolEventReceived();
 
-        // Removal related parameters
-        uint16_t removed_piece = data["removed_piece"].toInt();
-        QList<uint16_t> activePieces;
-        for (const auto& piece: data["active_pieces"].toArray()) {
-            activePieces.append(piece.toInt());
-        }
+    // Check the move against the one that was predicted for it
+    QList<MovePredictor::Prediction> rolledBack;
+    MovePredictor::Outcome outcome = predictor.moved(response.success, response.movedPiece, QPoint(response.x, response.y), phaseOf(response.nextState), response.nextPlayer, &rolledBack);
+    resolvePrediction(outcome, MovePredictor::Prediction(), rolledBack, response.movedPiece);
 
-        // Update the number of pieces
-        if(success) {
-            totalPieces[(currentTurn + 1) % 2] -= 1;
-        }
+    updateActivePieces(response);
 
-        // Notify the UI of the move's result
-        emit removePieceResponded(success, error, removed_piece, nextState, nextPlayer, activePieces);
+    qDebug() << "Next state:" << response.nextState << ", Active pieces:" << activePieces.bits();
 
-        // Update the game state
-        setState(nextState);
-        currentTurn = nextPlayer;
+    emit movePieceResponded(response.success, response.error, response.movedPiece, response.x, response.y, response.nextState, response.nextPlayer, activePieces.bits());
 
-    } catch (...) {
-        qDebug() << "Received an unexpected response.\n";
-    }
+    // Update the game state
+    setState(response.nextState);
+    currentTurn = response.nextPlayer;
 }
 
-void BoardManager::movePieceResponseHandler(QJsonObject &data){
-    try {
-        // Move-independent parameters
-        bool success = data["success"].toBool();
-        QString error = data["error"].toString();
-        int nextPlayer = data["next_player"].toInt();
-        QString nextState = data["next_state"].toString();
+void BoardManager::quitGameResponseHandler(const Protocol::QuitGameResponse &response){
+    RenderProfiler::Scope profile(RenderProfiler::Protocol);
+    Tracer::Scope trace("BoardManager::quitGameResponseHandler", "protocol");
+    emit protocolEventReceived();
 
-        // Movement related parameters
-        uint16_t movedPiece = data["moved_piece"].toInt();
-        uint8_t x = data["new_x"].toInt();
-        uint8_t y = data["new_y"].toInt();
-        QList<uint16_t> activePieces;
-        for (const auto& piece: data["active_pieces"].toArray()) {
-            activePieces.append(piece.toInt());
-        }
+    uint8_t flag = response.flag.isEmpty() ? 0 : response.flag.first();
 
-        qDebug() << "Next state:" << nextState << ", Active pieces:" << activePieces;
+    if (response.success){
+        running = false;
+        waiting = false;
+        resuming = false;
+        this->winner = response.winner;
+        predictor.stop();
+    }
 
-        emit movePieceResponded(success, error, movedPiece, x, y, nextState, nextPlayer, activePieces);
+    emit quitGameResponded(response.success, response.error, response.winner, flag, waiting);
+}
 
-        // Update the game state
-        setState(nextState);
-        currentTurn = nextPlayer;
+void BoardManager::syncActiveResponseHandler(const Protocol::SyncActiveResponse &response){
+    RenderProfiler::Scope profile(RenderProfiler::Protocol);
+    Tracer::Scope trace("BoardManager::syncActiveResponseHandler", "protocol");
+    emit protocolEventReceived();
 
-    } catch (...) {
-        qDebug() << "Received an unexpected response.\n";
+    if (!response.success) {
+        qDebug() << "Couldn't resync the active pieces:" << response.error;
+        return;
     }
+
+    activePieces.assign(response.activePieces, response.has(Protocol::SyncActiveResponse::Field_activeSeq) ? (int64_t)response.activeSeq : -1);
+
+    emit activePiecesSynced(activePieces.bits());
 }
 
-void BoardManager::quitGameResponseHandler(QJsonObject &data){
-    try {
-        bool success = data["success"].toBool();
-        QString error = data["error"].toString();
-        uint8_t winner = data["winner"].toInt();
-        uint8_t flag = data["flag"][0].toInt();
+void BoardManager::resumeGameResponseHandler(const Protocol::ResumeGameResponse &response){
+    RenderProfiler::Scope profile(RenderProfiler::Protocol);
+    Tracer::Scope trace("BoardManager::resumeGameResponseHandler", "protocol");
+    emit protocolEventReceived();
+    resuming = false;
 
-        if (success){
-            running = false;
-            waiting = false;
-            this->winner = winner;
-        }
+    // Rebuild the game state from the server's snapshot
+    setState(response.nextState);
+    currentTurn = response.nextPlayer;
 
-        emit quitGameResponded(success, error, winner, flag, waiting);
+    totalPieces[0] = 0;
+    totalPieces[1] = 0;
+    for (const PiecePosition &piece : response.pieces) {
+        totalPieces[piece.id & 0x1] += 1;
+    }
 
-    } catch (...) {
-        qDebug() << "Received an unexpected response.\n";
+    activePieces.assign(response.activePieces, response.has(Protocol::ResumeGameResponse::Field_activeSeq) ? (int64_t)response.activeSeq : -1);
+
+    // Predictions made before the drop are settled by the snapshot
+    if (geometry.nodeCount() > 0) {
+        predictor.load(geometry, response.pieces, phaseOf(response.nextState), response.nextPlayer);
     }
-}
 
+    emit gameResumed(response.nextState, response.nextPlayer, response.pieces, activePieces.bits());
+}
@@ -2,13 +2,24 @@
 #define BOARDMANAGER_H
 
 #include <QObject>
-#include <QtWebSockets/QWebSocket>
+#include <QThread>
 #include <stdint.h>
 #include <QPointF>
 #include <QPoint>
 #include <QHash>
 #include <QList>
 #include <QSettings>
+#include <QElapsedTimer>
+#include <QCborMap>
+#include <QBitArray>
+#include <functional>
+#include "protocol.h"
+#include "activepieceset.h"
+#include "protocolworker.h"
+#include "latencystats.h"
+#include "rules/geometry.h"
+#include "movepredictor.h"
+#include "localgame.h"
 
 enum GameState{
     STOPPED,
@@ -18,6 +29,12 @@ enum GameState{
     MOVEMENT
 };
 
+// Called with the server's response to a request.
+// If the response was lost in a dropped connection, the request is answered
+// with "success" false and "resumed" true, and the outcome is in the game
+// state the resumed game was restored to.
+typedef std::function<void(const QCborMap &response)> ResponseCallback;
+
 class BoardManager : public QObject
 {
     Q_OBJECT
@@ -29,6 +46,8 @@ public:
     bool running = false;
     bool waiting = false;
     bool status = false;
+    bool pendingStart = false;
+    bool resuming = false;
     uint8_t currentTurn = 0;
     uint16_t totalPieces[2] = {0, 0};
     uint8_t firstToJare = 0;
@@ -40,32 +59,59 @@ public:
     uint8_t playerTokens[2] = {0, 0};
 
     GameState gameState = GameState::STOPPED;
-    QWebSocket websocket;
+    bool binaryProtocol = true;
+    bool activeDelta = true;
+    ActivePieceSet activePieces;
+    // Bitboard description of the current board, for the rules engine
+    Rules::Geometry geometry;
+    // Local moves shown before the server confirms them
+    MovePredictor predictor;
+    bool prediction = true;
+    // CPU games are played against the local engine instead of the server
+    bool offline = false;
+    LatencyStats latency;
     QUrl url;
     QString mode;
     uint lobbyKey;
 
 public slots:
-    void onConnected();
-    void onTextMessageReceived(const QString &msg);
-    void error(QAbstractSocket::SocketError error);
-
-    void startGame();
-    void placePiece(uint8_t x, uint8_t y);
-    void removePiece(uint16_t pieceId);
-    void movePiece(uint16_t pieceId, uint8_t x, uint8_t y);
+    void startGame(ResponseCallback callback = nullptr);
+    // Return false if the move was rejected locally and never sent
+    bool placePiece(uint8_t x, uint8_t y, ResponseCallback callback = nullptr);
+    bool removePiece(uint16_t pieceId, ResponseCallback callback = nullptr);
+    bool movePiece(uint16_t pieceId, uint8_t x, uint8_t y, ResponseCallback callback = nullptr);
     void quitGame();
 
+    uint32_t sendRequest(QCborMap msg, ResponseCallback callback = nullptr);
+
+    // State the board will be in once the predicted moves are confirmed
+    GameState expectedState() const;
+
+    void requestGame();
+    void updateUrl();
     void reconnect();
 
 signals:
     void connected();
     void connectionError(QString error);
-    void startGameResponded(bool success, QString error, bool waiting, uint lobbyKey, QString nextState, uint8_t nextPlayer, QHash<QPoint, QList<QPoint>> adjacentPieces);
-    void placePieceResponded(bool success, QString error, uint16_t ID, uint8_t x, uint8_t y, QString nextState, uint8_t nextPlayer, QList<uint16_t> activePieces);
-    void removePieceResponded(bool success, QString error, uint16_t ID, QString nextState, uint8_t nextPlayer, QList<uint16_t> activePieces);
-    void movePieceResponded(bool success, QString error, uint16_t ID, uint8_t x, uint8_t y, QString nextState, uint8_t nextPlayer, QList<uint16_t> activePieces);
+    void startGameResponded(bool success, QString error, bool waiting, uint lobbyKey, QString nextState, uint8_t nextPlayer, BoardTopology adjacentPieces, QString topologyHash);
+    void placePieceResponded(bool success, QString error, uint16_t ID, uint8_t x, uint8_t y, QString nextState, uint8_t nextPlayer, QBitArray activePieces);
+    void removePieceResponded(bool success, QString error, uint16_t ID, QString nextState, uint8_t nextPlayer, QBitArray activePieces);
+    void movePieceResponded(bool success, QString error, uint16_t ID, uint8_t x, uint8_t y, QString nextState, uint8_t nextPlayer, QBitArray activePieces);
     void quitGameResponded(bool success, QString msg, uint8_t winner, uint8_t flag, bool waiting);
+    void activePiecesSynced(QBitArray activePieces);
+    void connectionInterrupted();
+    void gameResumed(QString nextState, uint8_t nextPlayer, PiecePositions pieces, QBitArray activePieces);
+
+    // Emitted for every message the worker passes on, used to measure GUI latency
+    void protocolEventReceived();
+
+    // A local move was applied ahead of the server
+    void movePredicted(MovePredictor::Prediction prediction, QBitArray activePieces);
+    // A predicted placement was accepted, pieceId is the ID the server gave it
+    void predictionConfirmed(MovePredictor::Prediction prediction, uint16_t pieceId);
+    // A predicted move was rejected or superseded and has to be undone
+    void predictionRolledBack(MovePredictor::Prediction prediction);
 
 private:
     const uint8_t TOTAL_PLAYERS = 2;
@@ -74,18 +120,42 @@ private:
     const double MARGIN_OF_ERROR = 0.2;
     const uint8_t ID_SHIFT = 1;
 
-    void connectSignals();
-    void sendMessage(QJsonObject msg);
+    // The websocket and the protocol decoding run on their own thread
+    // so the board stays responsive while messages are handled
+    QThread workerThread;
+    ProtocolWorker *worker;
+    LocalGame *localGame;
+
+    // Callbacks of the requests that haven't been answered yet
+    uint32_t nextRequestId = 1;
+    QHash<uint32_t, ResponseCallback> callbacks;
+
+    // Time from a game request to the server's join_game response
+    QElapsedTimer gameRequestTimer;
+    bool connectionReused = false;
 
-    QJsonObject loadJson(QString msg);
-    QString dumpJson(QJsonObject msg);
+    void connectSignals();
+    void loadSettings();
+    template<typename Response>
+    void updateActivePieces(const Response &response);
     void setState(QString s);
+    bool canPredict() const;
+    bool showPrediction(const std::optional<MovePredictor::Prediction> &prediction);
+    void resolvePrediction(MovePredictor::Outcome outcome, const MovePredictor::Prediction &confirmed, const QList<MovePredictor::Prediction> &rolledBack, uint16_t pieceId);
+
+    // Worker events
+    void onConnected();
+    void onDisconnected();
+    void onConnectionInterrupted();
+    void onRequestCompleted(uint32_t id, QCborMap response, int64_t receivedAt);
 
-    void startGameResponseHandler(QJsonObject &data);
-    void placePieceResponseHandler(QJsonObject &data);
-    void removePieceResponseHandler(QJsonObject &data);
-    void movePieceResponseHandler(QJsonObject &data);
-    void quitGameResponseHandler(QJsonObject &data);
+    void startGameResponseHandler(const Protocol::JoinGameResponse &response);
+    void placePieceResponseHandler(const Protocol::PlacePieceResponse &response);
+    void removePieceResponseHandler(const Protocol::RemovePieceResponse &response);
+    void movePieceResponseHandler(const Protocol::MovePieceResponse &response);
+    void quitGameResponseHandler(const Protocol::QuitGameResponse &response);
+    void syncActiveResponseHandler(const Protocol::SyncActiveResponse &response);
+    void resumeGameResponseHandler(const Protocol::ResumeGameResponse &response);
 };
 
 #endif // BOARDMANAGER_H
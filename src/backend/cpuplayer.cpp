@@ -0,0 +1,117 @@
+#include "cpuplayer.h"
+#include <QDebug>
+#include <QRandomGenerator>
+
+CpuPlayer::CpuPlayer(QObject *parent)
+    : QObject{parent}
+{
+}
+
+void CpuPlayer::think(const Rules::Geometry &geometry, const Rules::Position &position, int timeMs, uint32_t game){
+    // Queued before the game was restarted or quit
+    if (!isCurrent(game)) {
+        return;
+    }
+
+    openFiles(geometry);
+
+    // Known openings are played right away
+    Rules::Move bookMove = book.pick(geometry, position, QRandomGenerator::global()->generate());
+    if (bookMove != Rules::Move()) {
+        qDebug() << "CPU played a book move.";
+        emit moveFound(game, bookMove.raw());
+        return;
+    }
+
+    Rules::Search search(geometry, &table);
+    search.setTablebase(&tablebase);
+    {
+        // Checked again with the search in place, so a new game can't slip
+        // in between without stopping it
+        QMutexLocker locker(&mutex);
+        if (game != this->game) {
+            return;
+        }
+        this->search = &search;
+    }
+
+    Rules::SearchLimits limits;
+    limits.timeMs = timeMs;
+    limits.threads = threads;
+    Rules::SearchResult result = search.run(position, limits);
+
+    {
+        QMutexLocker locker(&mutex);
+        this->search = nullptr;
+    }
+
+    qDebug() << "CPU searched" << result.nodes << "nodes to depth" << result.depth
+             << "in" << result.timeMs << "ms, score" << result.score
+             << "- table hits" << result.ttHits << "/" << result.ttProbes
+             << "- tablebase hits" << result.tbHits;
+
+    emit moveFound(game, result.best.raw());
+}
+
+void CpuPlayer::stop(){
+    QMutexLocker locker(&mutex);
+    if (search) {
+        search->stop();
+    }
+}
+
+void CpuPlayer::newGame(uint32_t game){
+    QMutexLocker locker(&mutex);
+    this->game = game;
+    if (search) {
+        search->stop();
+    }
+}
+
+bool CpuPlayer::isCurrent(uint32_t game){
+    QMutexLocker locker(&mutex);
+    return game == this->game;
+}
+
+void CpuPlayer::setHashSize(int megabytes){
+    if (megabytes > 0 && (size_t)megabytes != table.megabytes()) {
+        table.resize(megabytes);
+    }
+}
+
+void CpuPlayer::setTablebasePath(const QString &path){
+    if (path != tablebasePath) {
+        tablebasePath = path;
+        filesBoard = 0;
+    }
+}
+
+void CpuPlayer::setBookPath(const QString &path){
+    if (path != bookPath) {
+        bookPath = path;
+        filesBoard = 0;
+    }
+}
+
+// Tables and books only fit the board they were made for
+void CpuPlayer::openFiles(const Rules::Geometry &geometry){
+    uint64_t board = geometry.key();
+    if (board == filesBoard) {
+        return;
+    }
+    filesBoard = board;
+
+    tablebase.close();
+    if (!tablebasePath.isEmpty()) {
+        int count = tablebase.open(tablebasePath.toStdString(), geometry);
+        qDebug() << "Mapped" << count << "endgame tables from" << tablebasePath;
+    }
+
+    book.close();
+    if (!bookPath.isEmpty()) {
+        if (book.open(bookPath.toStdString(), geometry))
+            qDebug() << "Mapped" << book.size() << "opening book entries from" << bookPath;
+        else
+            qDebug() << "No opening book for this board at" << bookPath;
+    }
+}
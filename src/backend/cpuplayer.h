@@ -0,0 +1,61 @@
+#ifndef CPUPLAYER_H
+#define CPUPLAYER_H
+
+#include <QObject>
+#include <QMutex>
+#include <QString>
+#include <stdint.h>
+#include "rules/search.h"
+#include "rules/openingbook.h"
+
+// Runs the search engine for the computer opponent.
+// Lives on its own thread so thinking never blocks the GUI.
+class CpuPlayer : public QObject
+{
+    Q_OBJECT
+public:
+    explicit CpuPlayer(QObject *parent = nullptr);
+
+    // Searches the position and emits moveFound when done.
+    // game is passed back untouched so stale answers can be recognised.
+    void think(const Rules::Geometry &geometry, const Rules::Position &position, int timeMs, uint32_t game);
+
+    // Cuts the current search short, callable from any thread
+    void stop();
+    // Stops the search and skips thinking still queued for earlier games,
+    // callable from any thread
+    void newGame(uint32_t game);
+
+    // Resizes the transposition table, which clears it
+    void setHashSize(int megabytes);
+    // Threads searching each move, they share the transposition table
+    void setThreads(int threads) { this->threads = threads; }
+    // Directory of the endgame tables, they're mapped on the next move
+    void setTablebasePath(const QString &path);
+    // Opening book file, it's mapped on the next move
+    void setBookPath(const QString &path);
+
+signals:
+    void moveFound(uint32_t game, uint16_t move);
+
+private:
+    QMutex mutex;
+    Rules::Search *search = nullptr;
+    // Game being played, guarded by mutex
+    uint32_t game = 0;
+    // Kept between moves, most of the last search is still useful
+    Rules::TranspositionTable table;
+    int threads = 1;
+
+    Rules::Tablebase tablebase;
+    QString tablebasePath;
+    Rules::OpeningBook book;
+    QString bookPath;
+    // Board the tables and the book were opened for, 0 if they haven't been
+    uint64_t filesBoard = 0;
+
+    void openFiles(const Rules::Geometry &geometry);
+    bool isCurrent(uint32_t game);
+};
+
+#endif // CPUPLAYER_H
@@ -1,7 +1,9 @@
 #include "gamepiece.h"
+#include "spritecache.h"
+#include "animationscheduler.h"
+#include "renderprofiler.h"
+#include "tracer.h"
 #include <QGraphicsScene>
-#include <QPropertyAnimation>
-#include <QGraphicsBlurEffect>
 
 
 GamePiece::GamePiece(uint16_t ID, float x, float y, float radius, QColor color)
@@ -19,20 +21,21 @@ GamePiece::GamePiece(uint16_t ID, float x, float y, float radius, QColor color)
     setPos(homePos);
 
     animateDropIn(radius);
+}
 
-    // Initialize the piece's animation
-    timer = new QTimeLine(300);
-    timer->setFrameRange(0, 100);
-
-    animation = new QGraphicsItemAnimation();
-    animation->setItem(this);
-    animation->setTimeLine(timer);
+GamePiece::~GamePiece(){
+    AnimationScheduler::instance()->stop(this);
 }
 
 void GamePiece::activate(bool isMovable){
     if (isMovable){
         setFlag(QGraphicsItem::ItemIsMovable);
     }
+
+    // Only pieces whose outline changes need repainting
+    if (movable != isMovable || removable == isMovable) {
+        update();
+    }
     movable = isMovable;
     removable = !isMovable;
 }
@@ -40,41 +43,53 @@ void GamePiece::activate(bool isMovable){
 void GamePiece::deactivate(){
     setFlag(QGraphicsItem::ItemIsMovable, false);
 
+    if (movable || removable) {
+        update();
+    }
     movable = false;
     removable = false;
 }
 
 
 // ********************************** OVERLOADS *********************************** //
+// Half of the highlight outline is outside the circle
 QRectF GamePiece::boundingRect() const{
-    return QRectF(-radius, -radius, radius*2, radius*2);
+    const float margin = 3;
+    return QRectF(-radius - margin, -radius - margin, (radius + margin)*2, (radius + margin)*2);
+}
+
+// Only the circle itself can be clicked
+QPainterPath GamePiece::shape() const{
+    QPainterPath path;
+    path.addEllipse(QRectF(-radius, -radius, radius*2, radius*2));
+    return path;
 }
 
 void GamePiece::paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget){
-    QRectF rect = boundingRect();
+    RenderProfiler::Scope profile(RenderProfiler::PiecePaint);
+    Tracer::Scope trace("GamePiece::paint", "paint");
+
+    SpriteCache::Circle circle;
+    circle.fill = color;
+    circle.radius = radius;
+    circle.sheen = sheenColorRatio;
 
 //    qDebug() << "Updated piece:" << ID;
 //    qDebug() << "ID: " << ID << ", Movable: " << movable << ", Removable: " << removable;
-    if (movable)
-        painter->setPen(QPen(QColor(0,150,0), 3));
-    else if (removable)
-        painter->setPen(QPen(QColor(150, 0, 0), 3));
-    else
-        painter->setPen(QPen(color, 1));
-
-    painter->setBrush(QBrush(color));
-
-    painter->drawEllipse(rect);
-    
-    QRectF highlightRect = QRectF(0,0,rect.width() * sheenColorRatio, rect.height() * sheenColorRatio);
-    QPointF center = rect.center();
-    highlightRect.moveCenter(rect.center());
-
-    QColor highlightColor = color.lighter(150);
-    painter->setPen(QPen(highlightColor, 2));
-    painter->setBrush(QBrush(highlightColor));
-
-    painter->drawArc(highlightRect, 120*16, 120*16);
+    if (movable) {
+        circle.outline = QColor(0, 150, 0);
+        circle.outlineWidth = 3;
+    }
+    else if (removable) {
+        circle.outline = QColor(150, 0, 0);
+        circle.outlineWidth = 3;
+    }
+    else {
+        circle.outline = color;
+        circle.outlineWidth = 1;
+    }
+
+    SpriteCache::draw(painter, circle);
 }
 
 
@@ -103,48 +118,22 @@ void GamePiece::movePiece(int16_t x, int16_t y){
         this->homePos.setY(y);
     }
 
-    // Clear the previous animation
-    animation->clear();
-
-    // Set the item's position for different frames
-    animation->setPosAt(0, currentPos);
-    animation->setPosAt(1, homePos);
-
-    timer->start();
+    // Slides back from wherever it was dragged to
+    AnimationScheduler::instance()->animate(this, AnimationScheduler::Pos, homePos, moveTime, QEasingCurve::InOutSine);
 }
 
 // ********************************** ANIMATIONS ******************************** //
 void GamePiece::animateDropIn(float radius){
-    // Add a blur effect to the game piece
-    QGraphicsBlurEffect *blurEffect = new QGraphicsBlurEffect();
-    blurEffect->setBlurHints(QGraphicsBlurEffect::QualityHint);
-    this->setGraphicsEffect(blurEffect);
-    
-    // Have the game piece come into focus as it's dropped in
-    QPropertyAnimation *focusAnimation = new QPropertyAnimation(blurEffect, "blurRadius");
-    focusAnimation->setDuration(dropInTime);
-    focusAnimation->setStartValue(7);
-    focusAnimation->setEndValue(0);
-    focusAnimation->setEasingCurve(QEasingCurve::OutQuad);
-
-    // Have the game piece reduce to it's actual size as it's dropped in
-    QPropertyAnimation *dropAnimation = new QPropertyAnimation(this, "scale");
-    dropAnimation->setDuration(dropInTime);
-    dropAnimation->setStartValue(4.0);
-    dropAnimation->setEndValue(1.0);
-    dropAnimation->setEasingCurve(QEasingCurve::OutBounce);
-
-    QObject::connect(dropAnimation, &QPropertyAnimation::finished, [=]() {
-        dropAnimation->deleteLater();
-        focusAnimation->deleteLater();
-        // TODO: Look into if I need to disconnect the blur effect before deleting it
-        blurEffect->deleteLater();
-
+    // The piece fades in as it shrinks to its actual size. A blur would look
+    // softer but renders every frame offscreen, for each piece.
+    setOpacity(0);
+    setScale(4);
+
+    AnimationScheduler *scheduler = AnimationScheduler::instance();
+    scheduler->animate(this, AnimationScheduler::Opacity, 1.0, dropInTime, QEasingCurve::OutQuad);
+    scheduler->animate(this, AnimationScheduler::Scale, 1.0, dropInTime, QEasingCurve::OutBounce, [this]() {
         GamePiece::setAcceptTouchEvents(true);
         setFlag(QGraphicsItem::ItemSendsScenePositionChanges);
         setFlag(QGraphicsItem::ItemSendsGeometryChanges);
     });
-
-    dropAnimation->start();
-    focusAnimation->start();
-}
\ No newline at end of file
+}
@@ -5,9 +5,8 @@
 #include <QObject>
 #include <QVariant>
 #include <QPainter>
+#include <QPainterPath>
 #include <QGraphicsSceneMouseEvent>
-#include <QGraphicsItemAnimation>
-#include <QTimeLine>
 
 
 class GamePiece : public QGraphicsObject
@@ -15,6 +14,7 @@ class GamePiece : public QGraphicsObject
     Q_OBJECT
 public:
     GamePiece(uint16_t ID, float x, float y, float radius, QColor color);
+    ~GamePiece();
 
     uint16_t ID;
     float radius;
@@ -24,6 +24,7 @@ public:
 
     // Visual Parameters
     int dropInTime = 700;
+    int moveTime = 300;
     float sheenColorRatio = 0.8;
 
     void activate(bool isMovable);
@@ -32,6 +33,7 @@ public:
     void movePiece(int16_t x, int16_t y);
 
     QRectF boundingRect() const;
+    QPainterPath shape() const;
     void paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget);
 
 signals:
@@ -46,10 +48,6 @@ private:
     void mousePressEvent(QGraphicsSceneMouseEvent *event);
     void mouseReleaseEvent(QGraphicsSceneMouseEvent *event);
 
-    // Animation variables
-    QTimeLine *timer;
-    QGraphicsItemAnimation *animation;
-
     // Animations
     void animateDropIn(float radius);
  };
@@ -0,0 +1,62 @@
+#include "latencyhistogram.h"
+#include <algorithm>
+
+void LatencyHistogram::record(int64_t us){
+    if (us < 0) {
+        us = 0;
+    }
+
+    buckets[bucketOf(us)]++;
+    total++;
+    maxValue = std::max(maxValue, us);
+}
+
+void LatencyHistogram::clear(){
+    buckets.fill(0);
+    total = 0;
+    maxValue = 0;
+}
+
+int64_t LatencyHistogram::percentile(double p) const{
+    if (total == 0) {
+        return 0;
+    }
+
+    // Rank of the sample we're looking for, counting from 1
+    uint64_t rank = std::max<uint64_t>(1, (uint64_t)(p * total + 0.5));
+    uint64_t seen = 0;
+
+    for (int i = 0; i < BUCKET_COUNT; i++) {
+        seen += buckets[i];
+        if (seen >= rank) {
+            // Never report more than what was actually recorded
+            return std::min(lowerBound(i), maxValue);
+        }
+    }
+    return maxValue;
+}
+
+int LatencyHistogram::bucketOf(int64_t us){
+    if (us < SUB_BUCKETS) {
+        return (int)us;
+    }
+
+    // Position of the highest bit picks the range, the next bits the bucket within it
+    int exponent = 63 - __builtin_clzll((uint64_t)us);
+    if (exponent > MAX_EXPONENT) {
+        return BUCKET_COUNT - 1;
+    }
+
+    int sub = (int)((us >> (exponent - SUB_BUCKET_BITS)) & (SUB_BUCKETS - 1));
+    return (exponent - SUB_BUCKET_BITS + 1) * SUB_BUCKETS + sub;
+}
+
+int64_t LatencyHistogram::lowerBound(int bucket){
+    if (bucket < SUB_BUCKETS) {
+        return bucket;
+    }
+
+    int exponent = bucket / SUB_BUCKETS + SUB_BUCKET_BITS - 1;
+    int sub = bucket % SUB_BUCKETS;
+    return ((int64_t)SUB_BUCKETS + sub) << (exponent - SUB_BUCKET_BITS);
+}
@@ -0,0 +1,35 @@
+#ifndef LATENCYHISTOGRAM_H
+#define LATENCYHISTOGRAM_H
+
+#include <array>
+#include <stdint.h>
+
+// Histogram of durations in microseconds.
+// Buckets are log-linear: exact below 16us, then 16 buckets per power of two,
+// so any percentile is within ~6% of the real value at a fixed size.
+class LatencyHistogram
+{
+public:
+    void record(int64_t us);
+    void clear();
+
+    // Value below which the given fraction (0-1) of the samples fall
+    int64_t percentile(double p) const;
+    int64_t max() const { return maxValue; }
+    uint64_t count() const { return total; }
+
+private:
+    static const int SUB_BUCKET_BITS = 4;
+    static const int SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+    static const int MAX_EXPONENT = 40;
+    static const int BUCKET_COUNT = (MAX_EXPONENT - SUB_BUCKET_BITS + 2) * SUB_BUCKETS;
+
+    std::array<uint32_t, BUCKET_COUNT> buckets{};
+    uint64_t total = 0;
+    int64_t maxValue = 0;
+
+    static int bucketOf(int64_t us);
+    static int64_t lowerBound(int bucket);
+};
+
+#endif // LATENCYHISTOGRAM_H
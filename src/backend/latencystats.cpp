@@ -0,0 +1,60 @@
+#include "latencystats.h"
+#include <QFile>
+#include <QTextStream>
+#include <QDateTime>
+
+void LatencyStats::record(const QString &name, int64_t us){
+    QMutexLocker locker(&mutex);
+    series[name].record(us);
+}
+
+void LatencyStats::clear(){
+    QMutexLocker locker(&mutex);
+    series.clear();
+}
+
+QList<LatencySummary> LatencyStats::summaries() const{
+    QMutexLocker locker(&mutex);
+
+    QList<LatencySummary> result;
+    result.reserve(series.size());
+
+    for (auto it = series.constBegin(); it != series.constEnd(); ++it) {
+        LatencySummary summary;
+        summary.name = it.key();
+        summary.count = it.value().count();
+        summary.p50 = it.value().percentile(0.50);
+        summary.p95 = it.value().percentile(0.95);
+        summary.p99 = it.value().percentile(0.99);
+        summary.max = it.value().max();
+        result.append(summary);
+    }
+    return result;
+}
+
+bool LatencyStats::dump(const QString &fileName) const{
+    const QList<LatencySummary> rows = summaries();
+    if (rows.isEmpty()) {
+        return true;
+    }
+
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text)) {
+        return false;
+    }
+
+    QTextStream stream(&file);
+    stream << "# Latencies in us, " << QDateTime::currentDateTime().toString(Qt::ISODate) << "\n";
+    stream << QString("%1 %2 %3 %4 %5 %6\n").arg("series", -24).arg("count", 8).arg("p50", 10).arg("p95", 10).arg("p99", 10).arg("max", 10);
+
+    for (const LatencySummary &row : rows) {
+        stream << QString("%1 %2 %3 %4 %5 %6\n")
+                      .arg(row.name, -24)
+                      .arg(row.count, 8)
+                      .arg(row.p50, 10)
+                      .arg(row.p95, 10)
+                      .arg(row.p99, 10)
+                      .arg(row.max, 10);
+    }
+    return true;
+}
@@ -0,0 +1,44 @@
+#ifndef LATENCYSTATS_H
+#define LATENCYSTATS_H
+
+#include <QString>
+#include <QMap>
+#include <QList>
+#include <QMutex>
+#include <QDeadlineTimer>
+#include <stdint.h>
+#include "latencyhistogram.h"
+
+// Summary of one series of measurements, in microseconds
+struct LatencySummary {
+    QString name;
+    uint64_t count = 0;
+    int64_t p50 = 0;
+    int64_t p95 = 0;
+    int64_t p99 = 0;
+    int64_t max = 0;
+};
+
+// Latency histograms shared by the protocol worker and the GUI thread.
+// Each series is named after what it measures, e.g. "place_piece" for the
+// round trip of a request or "place_piece/handling" for the client's side of it.
+class LatencyStats
+{
+public:
+    // Monotonic timestamp in ns, comparable across threads
+    static int64_t now() { return QDeadlineTimer::current(Qt::PreciseTimer).deadlineNSecs(); }
+
+    void record(const QString &series, int64_t us);
+    void clear();
+
+    QList<LatencySummary> summaries() const;
+
+    // Writes a table of the summaries to a text file
+    bool dump(const QString &fileName) const;
+
+private:
+    mutable QMutex mutex;
+    QMap<QString, LatencyHistogram> series;
+};
+
+#endif // LATENCYSTATS_H
@@ -0,0 +1,351 @@
+#include "localgame.h"
+#include "topologycache.h"
+#include "latencystats.h"
+#include <QDebug>
+
+LocalGame::LocalGame(QObject *parent)
+    : QObject{parent}
+{
+    // The standard board, in the form the server would send it
+    geometry = Rules::Geometry::standard();
+    for (int node = 0; node < geometry.nodeCount(); node++) {
+        QList<QPoint> neighbors;
+        for (Rules::Bitboard b = geometry.adjacent(node); b;) {
+            neighbors.append(pointOf(Rules::popLowest(b)));
+        }
+        topology.insert(pointOf(node), neighbors);
+    }
+    topologyHash = TopologyCache::hashOf(topology);
+
+    cpu = new CpuPlayer;
+    cpu->moveToThread(&engineThread);
+    QObject::connect(&engineThread, &QThread::finished, cpu, &QObject::deleteLater);
+    QObject::connect(cpu, &CpuPlayer::moveFound, this, &LocalGame::cpuMoveFound);
+    engineThread.setObjectName("CpuPlayer");
+    engineThread.start();
+}
+
+LocalGame::~LocalGame(){
+    cpu->stop();
+    engineThread.quit();
+    engineThread.wait();
+}
+
+void LocalGame::setHashSize(int megabytes){
+    // The table belongs to the engine thread
+    QMetaObject::invokeMethod(cpu, [cpu = cpu, megabytes]{
+        cpu->setHashSize(megabytes);
+    });
+}
+
+void LocalGame::setThreads(int threads){
+    QMetaObject::invokeMethod(cpu, [cpu = cpu, threads]{
+        cpu->setThreads(threads);
+    });
+}
+
+void LocalGame::setTablebasePath(const QString &path){
+    QMetaObject::invokeMethod(cpu, [cpu = cpu, path]{
+        cpu->setTablebasePath(path);
+    });
+}
+
+void LocalGame::setBookPath(const QString &path){
+    QMetaObject::invokeMethod(cpu, [cpu = cpu, path]{
+        cpu->setBookPath(path);
+    });
+}
+
+void LocalGame::handleRequest(uint32_t id, QCborMap msg){
+    QString action = msg.value("action").toString();
+
+    if (action == "join_game") {
+        joinGame(id);
+    }
+    else if (action == "quit_game") {
+        quitGame(id);
+    }
+    else if (action == "sync_active") {
+        syncActive(id);
+    }
+    else if (action == "place_piece" || action == "remove_piece" || action == "move_piece") {
+        playHumanMove(id, action, msg);
+    }
+    else {
+        complete(id, action, false, tr("Unknown action."));
+    }
+}
+
+
+// ******************************* REQUESTS ******************************** //
+void LocalGame::joinGame(uint32_t id){
+    game++;
+    cpu->newGame(game);
+
+    position = Rules::Position::start(geometry);
+    placed[0] = 0;
+    placed[1] = 0;
+    playing = true;
+
+    Protocol::JoinGameResponse response;
+    response.success = true;
+    response.waiting = false;
+    response.playerNum = humanSide;
+    response.nextState = stateName();
+    response.nextPlayer = position.side;
+    response.adjacentPieces = topology;
+    response.topologyHash = topologyHash;
+    response.present |= 1u << Protocol::JoinGameResponse::Field_adjacentPieces;
+
+    qDebug() << "Started an offline game against the CPU.";
+    emit joinGameReceived(response);
+    complete(id, "join_game", true);
+
+    if (position.side != humanSide) {
+        startThinking();
+    }
+}
+
+void LocalGame::quitGame(uint32_t id){
+    game++;
+    cpu->newGame(game);
+
+    Protocol::QuitGameResponse response;
+    response.success = true;
+    response.winner = (uint8_t)(humanSide ^ 1);
+    response.flag = {FLAG_FORFEIT};
+
+    playing = false;
+    emit quitGameReceived(response);
+    complete(id, "quit_game", true);
+}
+
+void LocalGame::syncActive(uint32_t id){
+    Protocol::SyncActiveResponse response;
+    response.success = true;
+    setActivePieces(response);
+
+    emit syncActiveReceived(response);
+    complete(id, "sync_active", true);
+}
+
+// Checks a move from the user like the server would, then plays it
+bool LocalGame::playHumanMove(uint32_t id, const QString &action, const QCborMap &msg){
+    Rules::Move move;
+
+    if (action == "place_piece") {
+        int node = geometry.indexOf({(int)msg.value("x").toInteger(), (int)msg.value("y").toInteger()});
+        if (node >= 0)
+            move = Rules::Move::place(node);
+    }
+    else {
+        uint16_t pieceId = (uint16_t)msg.value("piece_ID").toInteger();
+        int from = -1;
+        for (int node = 0; node < geometry.nodeCount(); node++) {
+            if ((position.occupied() & Rules::bitOf(node)) && pieceAt[node] == pieceId)
+                from = node;
+        }
+
+        if (from >= 0 && action == "remove_piece") {
+            move = Rules::Move::remove(from);
+        }
+        else if (from >= 0) {
+            int to = geometry.indexOf({(int)msg.value("new_x").toInteger(), (int)msg.value("new_y").toInteger()});
+            if (to >= 0)
+                move = Rules::Move::slide(from, to);
+        }
+    }
+
+    bool legal = playing && position.side == humanSide && move.type() != Rules::Move::None
+              && Rules::isLegal(geometry, position, move);
+
+    if (!legal) {
+        QString error = !playing ? tr("There's no game running.")
+                      : position.side != humanSide ? tr("It isn't your turn.")
+                      : tr("That move isn't allowed.");
+
+        // The UI needs the piece's ID to put it back
+        if (action == "place_piece") {
+            Protocol::PlacePieceResponse response;
+            response.error = error;
+            emit placePieceReceived(response);
+        }
+        else if (action == "remove_piece") {
+            Protocol::RemovePieceResponse response;
+            response.error = error;
+            response.removedPiece = (uint16_t)msg.value("piece_ID").toInteger();
+            emit removePieceReceived(response);
+        }
+        else {
+            Protocol::MovePieceResponse response;
+            response.error = error;
+            response.movedPiece = (uint16_t)msg.value("piece_ID").toInteger();
+            emit movePieceReceived(response);
+        }
+
+        complete(id, action, false, error);
+        return false;
+    }
+
+    playMove(move);
+    complete(id, action, true);
+    return true;
+}
+
+
+// ******************************** GAME *********************************** //
+void LocalGame::playMove(Rules::Move move){
+    const int side = position.side;
+    position = Rules::play(geometry, position, move);
+
+    switch (move.type()) {
+        case Rules::Move::Place: {
+            uint16_t pieceId = (uint16_t)(placed[side]++ * 2 + side);
+            pieceAt[move.to()] = pieceId;
+
+            Protocol::PlacePieceResponse response;
+            response.success = true;
+            response.nextState = stateName();
+            response.nextPlayer = position.side;
+            response.newPieceId = pieceId;
+            response.x = (uint8_t)pointOf(move.to()).x();
+            response.y = (uint8_t)pointOf(move.to()).y();
+            setActivePieces(response);
+            emit placePieceReceived(response);
+            break;
+        }
+        case Rules::Move::Remove: {
+            Protocol::RemovePieceResponse response;
+            response.success = true;
+            response.nextState = stateName();
+            response.nextPlayer = position.side;
+            response.removedPiece = pieceAt[move.from()];
+            setActivePieces(response);
+            emit removePieceReceived(response);
+            break;
+        }
+        case Rules::Move::Slide: {
+            pieceAt[move.to()] = pieceAt[move.from()];
+
+            Protocol::MovePieceResponse response;
+            response.success = true;
+            response.nextState = stateName();
+            response.nextPlayer = position.side;
+            response.movedPiece = pieceAt[move.to()];
+            response.x = (uint8_t)pointOf(move.to()).x();
+            response.y = (uint8_t)pointOf(move.to()).y();
+            setActivePieces(response);
+            emit movePieceReceived(response);
+            break;
+        }
+        case Rules::Move::None:
+            break;
+    }
+
+    if (position.phase == Rules::Phase::Over) {
+        finishGame();
+    }
+    else if (position.side != humanSide) {
+        startThinking();
+    }
+}
+
+void LocalGame::startThinking(){
+    uint32_t currentGame = game;
+    Rules::Geometry geometry = this->geometry;
+    Rules::Position position = this->position;
+    int moveTime = this->moveTime;
+
+    QMetaObject::invokeMethod(cpu, [cpu = cpu, geometry, position, moveTime, currentGame]{
+        cpu->think(geometry, position, moveTime, currentGame);
+    });
+}
+
+void LocalGame::cpuMoveFound(uint32_t game, uint16_t move){
+    // The game was quit or restarted while the engine was thinking
+    if (game != this->game || !playing) {
+        return;
+    }
+
+    Rules::Move cpuMove = Rules::Move::fromRaw(move);
+    if (!Rules::isLegal(geometry, position, cpuMove)) {
+        qWarning() << "The CPU came up with an illegal move, ending the game.";
+        position.phase = Rules::Phase::Over;
+        position.winner = (int8_t)humanSide;
+        position.rehash();
+        finishGame();
+        return;
+    }
+
+    playMove(cpuMove);
+}
+
+void LocalGame::finishGame(){
+    playing = false;
+
+    Protocol::QuitGameResponse response;
+    response.success = true;
+    response.winner = (uint8_t)qMax<int8_t>(position.winner, 0);
+    response.flag = {FLAG_WON};
+
+    qDebug() << "The offline game is over, player" << response.winner << "won.";
+    emit quitGameReceived(response);
+}
+
+
+// ******************************* HELPERS ********************************* //
+void LocalGame::complete(uint32_t id, const QString &action, bool success, const QString &error){
+    QCborMap response;
+    response["action"] = action;
+    response["request_id"] = (qint64)id;
+    response["success"] = success;
+    if (!error.isEmpty()) {
+        response["error"] = error;
+    }
+
+    emit requestCompleted(id, response, LatencyStats::now());
+}
+
+// The pieces the next player can remove or move, by ID
+template<typename Response>
+void LocalGame::setActivePieces(Response &response){
+    Rules::Bitboard nodes = 0;
+
+    if (position.phase == Rules::Phase::Removal || position.phase == Rules::Phase::FirstRemoval) {
+        nodes = Rules::removablePieces(geometry, position);
+    }
+    else if (position.phase == Rules::Phase::Movement) {
+        Rules::Bitboard empty = position.empty(geometry);
+        for (Rules::Bitboard own = position.pieces[position.side]; own;) {
+            int node = Rules::popLowest(own);
+            if (geometry.adjacent(node) & empty)
+                nodes |= Rules::bitOf(node);
+        }
+    }
+
+    response.activePieces.clear();
+    for (Rules::Bitboard b = nodes; b;) {
+        response.activePieces.append(pieceAt[Rules::popLowest(b)]);
+    }
+    response.present |= 1u << Response::Field_activePieces;
+}
+
+QString LocalGame::stateName() const{
+    switch (position.phase) {
+        case Rules::Phase::Placement:
+            return "PLACEMENT";
+        case Rules::Phase::FirstRemoval:
+            return "FIRST_REMOVAL";
+        case Rules::Phase::Removal:
+            return "REMOVAL";
+        case Rules::Phase::Movement:
+            return "MOVEMENT";
+        default:
+            return "STOPPED";
+    }
+}
+
+QPoint LocalGame::pointOf(int node) const{
+    Rules::Point p = geometry.point(node);
+    return QPoint(p.x, p.y);
+}
@@ -0,0 +1,91 @@
+#ifndef LOCALGAME_H
+#define LOCALGAME_H
+
+#include <QObject>
+#include <QThread>
+#include <QCborMap>
+#include <QHash>
+#include <stdint.h>
+#include "protocol.h"
+#include "rules/position.h"
+#include "cpuplayer.h"
+
+// Offline game against the computer.
+// Stands in for the server: it takes the same requests and answers them with
+// the same typed responses as ProtocolWorker, so BoardManager and the UI
+// can't tell the difference. The computer's moves come from CpuPlayer.
+class LocalGame : public QObject
+{
+    Q_OBJECT
+public:
+    explicit LocalGame(QObject *parent = nullptr);
+    ~LocalGame();
+
+    // Time the computer gets per move, in ms
+    void setMoveTime(int ms) { moveTime = ms; }
+    // Player the user plays as, 0 moves first
+    void setHumanSide(uint8_t side) { humanSide = side; }
+    // Size of the computer's transposition table, in MB
+    void setHashSize(int megabytes);
+    // Threads the computer searches with
+    void setThreads(int threads);
+    // Directory of the computer's endgame tables
+    void setTablebasePath(const QString &path);
+    // The computer's opening book
+    void setBookPath(const QString &path);
+
+public slots:
+    void handleRequest(uint32_t id, QCborMap msg);
+
+signals:
+    void requestCompleted(uint32_t id, QCborMap response, int64_t receivedAt);
+
+    void joinGameReceived(Protocol::JoinGameResponse response);
+    void placePieceReceived(Protocol::PlacePieceResponse response);
+    void removePieceReceived(Protocol::RemovePieceResponse response);
+    void movePieceReceived(Protocol::MovePieceResponse response);
+    void quitGameReceived(Protocol::QuitGameResponse response);
+    void syncActiveReceived(Protocol::SyncActiveResponse response);
+
+private:
+    // Game over flags, as sent by the server
+    const uint8_t FLAG_WON = 0x2;
+    const uint8_t FLAG_FORFEIT = 0x3;
+
+    QThread engineThread;
+    CpuPlayer *cpu;
+    int moveTime = 1000;
+    uint8_t humanSide = 0;
+
+    Rules::Geometry geometry;
+    BoardTopology topology;
+    QString topologyHash;
+
+    Rules::Position position;
+    bool playing = false;
+    // Bumped every game so late answers from the engine are ignored
+    uint32_t game = 0;
+
+    // Piece IDs, even for player 0 and odd for player 1 like the server's
+    uint16_t pieceAt[Rules::MAX_NODES];
+    uint16_t placed[2] = {0, 0};
+
+    void joinGame(uint32_t id);
+    void quitGame(uint32_t id);
+    void syncActive(uint32_t id);
+    bool playHumanMove(uint32_t id, const QString &action, const QCborMap &msg);
+
+    // Plays a legal move and reports it the way the server would
+    void playMove(Rules::Move move);
+    void cpuMoveFound(uint32_t game, uint16_t move);
+    void startThinking();
+    void finishGame();
+
+    void complete(uint32_t id, const QString &action, bool success, const QString &error = QString());
+    template<typename Response>
+    void setActivePieces(Response &response);
+    QString stateName() const;
+    QPoint pointOf(int node) const;
+};
+
+#endif // LOCALGAME_H
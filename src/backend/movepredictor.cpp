@@ -0,0 +1,254 @@
+#include "movepredictor.h"
+#include <QDebug>
+
+void MovePredictor::reset(const Rules::Geometry &geometry, Rules::Phase phase, uint8_t side){
+    this->geometry = geometry;
+
+    confirmedPosition = Rules::Position::start(geometry, side);
+    confirmedPosition.phase = phase;
+    confirmedPosition.rehash();
+    confirmedNodes.clear();
+
+    pending.clear();
+    predictedPosition = confirmedPosition;
+    predictedNodes = confirmedNodes;
+    active = geometry.nodeCount() > 0;
+}
+
+void MovePredictor::load(const Rules::Geometry &geometry, const PiecePositions &pieces, Rules::Phase phase, uint8_t side){
+    reset(geometry, phase, side);
+
+    for (const PiecePosition &piece : pieces) {
+        int node = nodeOf(QPoint(piece.x, piece.y));
+        if (node < 0) {
+            qWarning() << "Can't predict moves, a piece is off the board:" << piece.x << piece.y;
+            active = false;
+            return;
+        }
+
+        confirmedPosition.pieces[piece.id & 0x1] |= Rules::bitOf(node);
+        confirmedNodes.insert(piece.id, node);
+    }
+
+    // Nothing is removed while placing, so what's on the board tells what's left in hand
+    for (int player = 0; player < 2; player++) {
+        int left = geometry.piecesPerPlayer() - confirmedPosition.onBoard(player);
+        confirmedPosition.inHand[player] = phase == Rules::Phase::Placement ? (uint8_t)qMax(left, 0) : 0;
+    }
+    confirmedPosition.rehash();
+
+    predictedPosition = confirmedPosition;
+    predictedNodes = confirmedNodes;
+}
+
+void MovePredictor::stop(){
+    active = false;
+    pending.clear();
+}
+
+
+// ***************************** LOCAL MOVES ******************************* //
+std::optional<MovePredictor::Prediction> MovePredictor::place(QPoint at){
+    int node = nodeOf(at);
+    if (node < 0) {
+        return std::nullopt;
+    }
+
+    uint16_t id = TEMP_ID_BASE + (uint16_t)(nextTempId++ << 1) + predictedPosition.side;
+    nextTempId &= 0x3ff;
+
+    return predict(Rules::Move::place(node), id);
+}
+
+std::optional<MovePredictor::Prediction> MovePredictor::remove(uint16_t pieceId){
+    if (!predictedNodes.contains(pieceId)) {
+        return std::nullopt;
+    }
+
+    return predict(Rules::Move::remove(predictedNodes.value(pieceId)), pieceId);
+}
+
+std::optional<MovePredictor::Prediction> MovePredictor::move(uint16_t pieceId, QPoint to){
+    int node = nodeOf(to);
+    if (node < 0 || !predictedNodes.contains(pieceId)) {
+        return std::nullopt;
+    }
+
+    return predict(Rules::Move::slide(predictedNodes.value(pieceId), node), pieceId);
+}
+
+std::optional<MovePredictor::Prediction> MovePredictor::predict(Rules::Move move, uint16_t pieceId){
+    if (!active || !Rules::isLegal(geometry, predictedPosition, move)) {
+        return std::nullopt;
+    }
+
+    Prediction prediction;
+    prediction.move = move;
+    prediction.pieceId = pieceId;
+    prediction.from = move.type() == Rules::Move::Place ? QPoint(-1, -1) : pointOf(move.from());
+    prediction.to = move.type() == Rules::Move::Remove ? QPoint(-1, -1) : pointOf(move.to());
+
+    apply(predictedPosition, predictedNodes, move, pieceId);
+    pending.append(prediction);
+    return prediction;
+}
+
+// Plays a move and keeps track of where the piece it involves ends up
+void MovePredictor::apply(Rules::Position &position, QHash<uint16_t, int> &nodes, Rules::Move move, uint16_t pieceId){
+    position = Rules::play(geometry, position, move);
+
+    if (move.type() == Rules::Move::Remove)
+        nodes.remove(pieceId);
+    else
+        nodes.insert(pieceId, move.to());
+}
+
+
+// *************************** SERVER RESULTS ****************************** //
+MovePredictor::Outcome MovePredictor::placed(bool success, uint16_t id, QPoint at, Rules::Phase phase, uint8_t side, Prediction *confirmed, QList<Prediction> *rolledBack){
+    int node = nodeOf(at);
+    return resolve(success && node >= 0, Rules::Move::place(qMax(node, 0)), id, phase, side, confirmed, rolledBack);
+}
+
+MovePredictor::Outcome MovePredictor::removed(bool success, uint16_t id, Rules::Phase phase, uint8_t side, QList<Prediction> *rolledBack){
+    int node = confirmedNodes.value(id, -1);
+    return resolve(success && node >= 0, Rules::Move::remove(qMax(node, 0)), id, phase, side, nullptr, rolledBack);
+}
+
+MovePredictor::Outcome MovePredictor::moved(bool success, uint16_t id, QPoint to, Rules::Phase phase, uint8_t side, QList<Prediction> *rolledBack){
+    int from = confirmedNodes.value(id, -1);
+    int node = nodeOf(to);
+    return resolve(success && from >= 0 && node >= 0, Rules::Move::slide(qMax(from, 0), qMax(node, 0)), id, phase, side, nullptr, rolledBack);
+}
+
+MovePredictor::Outcome MovePredictor::resolve(bool success, Rules::Move move, uint16_t pieceId, Rules::Phase phase, uint8_t side, Prediction *confirmed, QList<Prediction> *rolledBack){
+    if (!active) {
+        return Unpredicted;
+    }
+
+    // The server is always right about the confirmed position
+    if (success) {
+        if (Rules::isLegal(geometry, confirmedPosition, move)) {
+            apply(confirmedPosition, confirmedNodes, move, pieceId);
+        }
+        else {
+            qDebug() << "The rules engine disagrees with the server about a move, taking the server's word for it.";
+            applyUnchecked(move, pieceId);
+        }
+
+        confirmedPosition.phase = phase;
+        confirmedPosition.side = side;
+        confirmedPosition.winner = -1;
+        confirmedPosition.rehash();
+    }
+
+    // Only the local player's requests are predicted, and the server answers
+    // them before anything else can happen in the game
+    if (pending.isEmpty()) {
+        predictedPosition = confirmedPosition;
+        predictedNodes = confirmedNodes;
+        return Unpredicted;
+    }
+
+    Prediction head = pending.takeFirst();
+    if (success && head.move == move) {
+        if (confirmed) {
+            *confirmed = head;
+        }
+        replay(rolledBack);
+        return Confirmed;
+    }
+
+    pending.prepend(head);
+    for (auto it = pending.crbegin(); it != pending.crend(); ++it) {
+        rolledBack->append(*it);
+    }
+    pending.clear();
+
+    predictedPosition = confirmedPosition;
+    predictedNodes = confirmedNodes;
+    return Mispredicted;
+}
+
+// Moves the pieces like the server says, whether or not the rules engine agrees
+void MovePredictor::applyUnchecked(Rules::Move move, uint16_t pieceId){
+    Rules::Position &p = confirmedPosition;
+    const int player = pieceId & 0x1;
+
+    switch (move.type()) {
+        case Rules::Move::Place:
+            p.pieces[player] |= Rules::bitOf(move.to());
+            if (p.inHand[player] > 0)
+                p.inHand[player]--;
+            confirmedNodes.insert(pieceId, move.to());
+            break;
+        case Rules::Move::Remove:
+            p.pieces[player] &= ~Rules::bitOf(move.from());
+            confirmedNodes.remove(pieceId);
+            break;
+        case Rules::Move::Slide:
+            p.pieces[player] = (p.pieces[player] & ~Rules::bitOf(move.from())) | Rules::bitOf(move.to());
+            confirmedNodes.insert(pieceId, move.to());
+            break;
+        case Rules::Move::None:
+            break;
+    }
+}
+
+// Rebuilds the predicted position from the confirmed one.
+// Predictions that aren't legal anymore are dropped with everything after them.
+void MovePredictor::replay(QList<Prediction> *rolledBack){
+    predictedPosition = confirmedPosition;
+    predictedNodes = confirmedNodes;
+
+    for (qsizetype i = 0; i < pending.size(); i++) {
+        if (Rules::isLegal(geometry, predictedPosition, pending[i].move)) {
+            apply(predictedPosition, predictedNodes, pending[i].move, pending[i].pieceId);
+            continue;
+        }
+
+        for (qsizetype j = pending.size() - 1; j >= i; j--) {
+            rolledBack->append(pending.takeAt(j));
+        }
+        break;
+    }
+}
+
+
+// ******************************* HELPERS ********************************* //
+QBitArray MovePredictor::activePieces() const{
+    Rules::Bitboard nodes = 0;
+    const Rules::Position &p = predictedPosition;
+
+    if (p.phase == Rules::Phase::Removal || p.phase == Rules::Phase::FirstRemoval) {
+        nodes = Rules::removablePieces(geometry, p);
+    }
+    else if (p.phase == Rules::Phase::Movement) {
+        Rules::Bitboard empty = p.empty(geometry);
+        for (Rules::Bitboard own = p.pieces[p.side]; own;) {
+            int node = Rules::popLowest(own);
+            if (geometry.adjacent(node) & empty)
+                nodes |= Rules::bitOf(node);
+        }
+    }
+
+    QBitArray bits;
+    for (auto it = predictedNodes.constBegin(); it != predictedNodes.constEnd(); ++it) {
+        if (!(nodes & Rules::bitOf(it.value())))
+            continue;
+
+        if (it.key() >= bits.size())
+            bits.resize((it.key() / 64 + 1) * 64);
+        bits.setBit(it.key());
+    }
+    return bits;
+}
+
+int MovePredictor::nodeOf(QPoint p) const{
+    return geometry.indexOf({p.x(), p.y()});
+}
+
+QPoint MovePredictor::pointOf(int node) const{
+    Rules::Point p = geometry.point(node);
+    return QPoint(p.x, p.y);
+}
@@ -0,0 +1,93 @@
+#ifndef MOVEPREDICTOR_H
+#define MOVEPREDICTOR_H
+
+#include <QHash>
+#include <QList>
+#include <QPoint>
+#include <QBitArray>
+#include <optional>
+#include <stdint.h>
+#include "protocol.h"
+#include "rules/position.h"
+
+// Applies the local player's moves before the server has answered them.
+//
+// Two positions are kept: the confirmed one, built only from the server's
+// responses, and the predicted one, which is the confirmed position with the
+// moves still waiting on the server played on top. When a response comes in
+// it's applied to the confirmed position and checked against the oldest
+// prediction. A mismatch drops every outstanding prediction, since the later
+// ones were made on top of it, and hands them back so they can be undone.
+class MovePredictor
+{
+public:
+    struct Prediction {
+        Rules::Move move;
+        // Temporary ID for a placed piece, until the server gives it a real one
+        uint16_t pieceId = 0;
+        QPoint from;
+        QPoint to;
+    };
+
+    enum Outcome {
+        // Not an answer to a prediction (an opponent's move or an unpredicted request)
+        Unpredicted,
+        Confirmed,
+        Mispredicted
+    };
+
+    // Starts predicting on an empty board
+    void reset(const Rules::Geometry &geometry, Rules::Phase phase, uint8_t side);
+    // Starts predicting from a snapshot of a game in progress
+    void load(const Rules::Geometry &geometry, const PiecePositions &pieces, Rules::Phase phase, uint8_t side);
+    void stop();
+
+    bool isActive() const { return active; }
+    // Whether the ID belongs to a predicted piece the server hasn't numbered yet
+    bool isTemporary(uint16_t pieceId) const { return pieceId >= TEMP_ID_BASE; }
+    bool hasPending() const { return !pending.isEmpty(); }
+    const Rules::Position &predicted() const { return predictedPosition; }
+    const Rules::Position &confirmed() const { return confirmedPosition; }
+
+    // Local moves, predicted if they're legal in the predicted position
+    std::optional<Prediction> place(QPoint at);
+    std::optional<Prediction> remove(uint16_t pieceId);
+    std::optional<Prediction> move(uint16_t pieceId, QPoint to);
+
+    // Server results, in the order they were received.
+    // On a confirmed placement, confirmed holds the prediction (and its temporary ID).
+    // On a misprediction, rolledBack holds the undone predictions, newest first.
+    Outcome placed(bool success, uint16_t id, QPoint at, Rules::Phase phase, uint8_t side, Prediction *confirmed, QList<Prediction> *rolledBack);
+    Outcome removed(bool success, uint16_t id, Rules::Phase phase, uint8_t side, QList<Prediction> *rolledBack);
+    Outcome moved(bool success, uint16_t id, QPoint to, Rules::Phase phase, uint8_t side, QList<Prediction> *rolledBack);
+
+    // Pieces the side to move can act on in the predicted position
+    QBitArray activePieces() const;
+
+private:
+    // First temporary ID, above anything the server hands out.
+    // The lowest bit still tells the player, like real IDs.
+    static const uint16_t TEMP_ID_BASE = 0xF000;
+
+    Rules::Geometry geometry;
+    bool active = false;
+
+    Rules::Position confirmedPosition;
+    Rules::Position predictedPosition;
+    // Node of every piece on the board, by piece ID
+    QHash<uint16_t, int> confirmedNodes;
+    QHash<uint16_t, int> predictedNodes;
+
+    QList<Prediction> pending;
+    uint16_t nextTempId = 0;
+
+    std::optional<Prediction> predict(Rules::Move move, uint16_t pieceId);
+    void apply(Rules::Position &position, QHash<uint16_t, int> &nodes, Rules::Move move, uint16_t pieceId);
+    void applyUnchecked(Rules::Move move, uint16_t pieceId);
+    Outcome resolve(bool success, Rules::Move move, uint16_t pieceId, Rules::Phase phase, uint8_t side, Prediction *confirmed, QList<Prediction> *rolledBack);
+    void replay(QList<Prediction> *rolledBack);
+    int nodeOf(QPoint p) const;
+    QPoint pointOf(int node) const;
+};
+
+#endif // MOVEPREDICTOR_H
@@ -0,0 +1,230 @@
+#include "protocol.h"
+#include <QCborValue>
+#include <QCborArray>
+#include <cmath>
+#include <limits>
+#include <type_traits>
+
+namespace Protocol {
+
+uint32_t keyHash(QStringView key){
+    uint32_t hash = 2166136261u;
+    for (QChar c : key) {
+        hash = (hash ^ (uint8_t)c.unicode()) * 16777619u;
+    }
+    return hash;
+}
+
+
+// ************************** FIELD DECODERS ****************************** //
+namespace {
+
+bool decodeField(const QCborValue &value, bool &out){
+    if (!value.isBool())
+        return false;
+
+    out = value.toBool();
+    return true;
+}
+
+bool decodeField(const QCborValue &value, QString &out){
+    // Treat a null string as an empty one
+    if (value.isNull()) {
+        out.clear();
+        return true;
+    }
+
+    if (!value.isString())
+        return false;
+
+    out = value.toString();
+    return true;
+}
+
+// Integers must fit in the member they're decoded into
+template<typename T>
+std::enable_if_t<std::is_integral_v<T> && !std::is_same_v<T, bool>, bool>
+decodeField(const QCborValue &value, T &out){
+    const qint64 min = std::numeric_limits<T>::min();
+    const qint64 max = std::numeric_limits<T>::max();
+
+    qint64 v;
+    if (value.isInteger()) {
+        v = value.toInteger();
+    }
+    // Whole numbers can show up as doubles when they come from JSON
+    else if (value.isDouble()) {
+        double d = value.toDouble();
+        if (d != std::floor(d) || d < min || d > max)
+            return false;
+        v = (qint64)d;
+    }
+    else {
+        return false;
+    }
+
+    if (v < min || v > max)
+        return false;
+
+    out = (T)v;
+    return true;
+}
+
+// Each piece is {piece_ID, x, y}
+bool decodeField(const QCborValue &value, PiecePosition &out){
+    if (!value.isMap())
+        return false;
+
+    const QCborMap piece = value.toMap();
+    return decodeField(piece.value(QLatin1String("piece_ID")), out.id)
+        && decodeField(piece.value(QLatin1String("x")), out.x)
+        && decodeField(piece.value(QLatin1String("y")), out.y);
+}
+
+// Lists decode their items with the overloads declared above
+template<typename T>
+bool decodeField(const QCborValue &value, QList<T> &out){
+    if (!value.isArray())
+        return false;
+
+    const QCborArray items = value.toArray();
+    out.clear();
+    out.reserve(items.size());
+
+    for (const QCborValue item : items) {
+        T v;
+        if (!decodeField(item, v))
+            return false;
+        out.append(v);
+    }
+    return true;
+}
+
+bool decodePoint(const QCborMap &point, QPoint &out){
+    int x, y;
+    if (!decodeField(point.value(QLatin1String("x")), x) || !decodeField(point.value(QLatin1String("y")), y))
+        return false;
+
+    out = QPoint(x, y);
+    return true;
+}
+
+// Each node is {x, y, neighbors: [{x, y}, ...]}
+bool decodeField(const QCborValue &value, BoardTopology &out){
+    if (!value.isArray())
+        return false;
+
+    const QCborArray nodes = value.toArray();
+    out.clear();
+    out.reserve(nodes.size());
+
+    for (const QCborValue node : nodes) {
+        if (!node.isMap())
+            return false;
+
+        const QCborMap nodeMap = node.toMap();
+        QPoint p;
+        if (!decodePoint(nodeMap, p))
+            return false;
+
+        const QCborValue neighbors = nodeMap.value(QLatin1String("neighbors"));
+        if (!neighbors.isArray())
+            return false;
+
+        QList<QPoint> neighborPoints;
+        for (const QCborValue neighbor : neighbors.toArray()) {
+            QPoint n;
+            if (!neighbor.isMap() || !decodePoint(neighbor.toMap(), n))
+                return false;
+            neighborPoints.append(n);
+        }
+
+        out.insert(p, neighborPoints);
+    }
+    return true;
+}
+
+bool isMissing(Presence presence, bool success){
+    return presence == Presence::Required || (presence == Presence::OnSuccess && success);
+}
+
+} // namespace
+
+
+// ************************** GENERATED DECODERS ************************** //
+Action actionOf(const QCborMap &data){
+    const QCborValue value = data.value(QLatin1String("action"));
+    if (!value.isString())
+        return Action::Unknown;
+
+    const QString name = value.toString();
+
+#define SHAX_ACTION_CASE(Name, wire, FIELDS) \
+    case keyHash(wire): \
+        return name == QLatin1String(wire) ? Action::Name : Action::Unknown;
+
+    switch (keyHash(name)) {
+        SHAX_PROTOCOL_ACTIONS(SHAX_ACTION_CASE)
+        default:
+            return Action::Unknown;
+    }
+
+#undef SHAX_ACTION_CASE
+}
+
+QString actionName(Action action){
+#define SHAX_ACTION_NAME(Name, wire, FIELDS) \
+    case Action::Name: \
+        return QStringLiteral(wire);
+
+    switch (action) {
+        SHAX_PROTOCOL_ACTIONS(SHAX_ACTION_NAME)
+        default:
+            return QString();
+    }
+
+#undef SHAX_ACTION_NAME
+}
+
+#define SHAX_DECODE_FIELD_CASE(type, member, wire, presence) \
+    case keyHash(wire): \
+        if (name != QLatin1String(wire)) \
+            break; \
+        if (!decodeField(value, out.member)) { \
+            error = QString("\"%1\" has an unexpected type").arg(QLatin1String(wire)); \
+            return false; \
+        } \
+        out.present |= 1u << Response::Field_##member; \
+        break;
+
+#define SHAX_CHECK_FIELD(type, member, wire, presence) \
+    if (!out.has(Response::Field_##member) && isMissing(Presence::presence, out.success)) { \
+        error = QString("\"%1\" is missing").arg(QLatin1String(wire)); \
+        return false; \
+    }
+
+#define SHAX_DECODE_DEF(Name, wire, FIELDS) \
+    bool decode(const QCborMap &data, Name##Response &out, QString &error){ \
+        using Response = Name##Response; \
+        static_assert(Response::FieldCount <= 32, "Too many fields for the presence mask"); \
+        out = Response(); \
+        for (auto it = data.constBegin(), end = data.constEnd(); it != end; ++it) { \
+            const QString name = it.key().toString(); \
+            const QCborValue value = it.value(); \
+            switch (keyHash(name)) { \
+                FIELDS(SHAX_DECODE_FIELD_CASE) \
+                default: \
+                    break; \
+            } \
+        } \
+        FIELDS(SHAX_CHECK_FIELD) \
+        return true; \
+    }
+
+SHAX_PROTOCOL_ACTIONS(SHAX_DECODE_DEF)
+
+#undef SHAX_DECODE_DEF
+#undef SHAX_CHECK_FIELD
+#undef SHAX_DECODE_FIELD_CASE
+
+} // namespace Protocol
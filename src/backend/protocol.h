@@ -0,0 +1,77 @@
+#ifndef PROTOCOL_H
+#define PROTOCOL_H
+
+#include <QCborMap>
+#include <QString>
+#include <QStringView>
+#include <QPoint>
+#include <QHash>
+#include <QList>
+#include <stdint.h>
+#include "protocolschema.h"
+
+// Graph of the board's nodes, each node maps to its neighbors
+typedef QHash<QPoint, QList<QPoint>> BoardTopology;
+typedef QList<uint16_t> PieceList;
+typedef QList<uint8_t> FlagList;
+
+// Piece on the board, as sent in game snapshots
+struct PiecePosition {
+    uint16_t id = 0;
+    uint8_t x = 0;
+    uint8_t y = 0;
+};
+typedef QList<PiecePosition> PiecePositions;
+
+namespace Protocol {
+
+// FNV-1a hash of a message key.
+// Every action and field name is switched on through this hash, so two names
+// colliding within the same message is a compile error (duplicate case label).
+constexpr uint32_t keyHash(const char *key, uint32_t hash = 2166136261u){
+    return *key ? keyHash(key + 1, (hash ^ (uint8_t)*key) * 16777619u) : hash;
+}
+uint32_t keyHash(QStringView key);
+
+enum class Presence {
+    Required,
+    OnSuccess,
+    Optional
+};
+
+// ************************** GENERATED TYPES ***************************** //
+#define SHAX_ACTION_ID(Name, wire, FIELDS) Name,
+enum class Action {
+    SHAX_PROTOCOL_ACTIONS(SHAX_ACTION_ID)
+    Unknown
+};
+#undef SHAX_ACTION_ID
+
+#define SHAX_FIELD_ID(type, member, wire, presence) Field_##member,
+#define SHAX_FIELD_MEMBER(type, member, wire, presence) type member{};
+#define SHAX_RESPONSE_STRUCT(Name, wire, FIELDS) \
+    struct Name##Response { \
+        enum Field { FIELDS(SHAX_FIELD_ID) FieldCount }; \
+        FIELDS(SHAX_FIELD_MEMBER) \
+        uint32_t present = 0; \
+        bool has(Field f) const { return present & (1u << f); } \
+    };
+SHAX_PROTOCOL_ACTIONS(SHAX_RESPONSE_STRUCT)
+#undef SHAX_RESPONSE_STRUCT
+#undef SHAX_FIELD_MEMBER
+#undef SHAX_FIELD_ID
+
+// Gets the action of a message, Action::Unknown if it's missing or unexpected
+Action actionOf(const QCborMap &data);
+QString actionName(Action action);
+
+// Decodes a message into its typed response in a single pass over its fields.
+// Returns false and describes the problem in error if the message is malformed.
+#define SHAX_DECODE_DECL(Name, wire, FIELDS) \
+    bool decode(const QCborMap &data, Name##Response &out, QString &error);
+SHAX_PROTOCOL_ACTIONS(SHAX_DECODE_DECL)
+#undef SHAX_DECODE_DECL
+
+} // namespace Protocol
+
+#endif // PROTOCOL_H
@@ -0,0 +1,112 @@
+#ifndef PROTOCOLSCHEMA_H
+#define PROTOCOLSCHEMA_H
+
+// Single description of the server's responses.
+// Everything in protocol.h/protocol.cpp (the response structs, the action IDs
+// and the decoders) is generated from these lists, so a new field or action
+// only has to be added here.
+//
+// ACTION(Name, "wire name", FIELD_LIST)
+// FIELD(C++ type, member, "wire key", presence)
+//
+// Presence is one of:
+//   Required  - must be in every response
+//   OnSuccess - must be in the response when "success" is true
+//   Optional  - may be left out, the member keeps its default value
+//
+// Moves carry the active pieces either in full (active_pieces) or, when the
+// client asked for deltas, as the pieces that changed (active_changed).
+// Both come with a sequence number (active_seq) so missed updates are noticed.
+// join_game may send the sequence number of the empty set the game starts
+// with, 0 if it doesn't.
+//
+// Every request carries a request_id that the server echoes in its response.
+// The worker puts a per-client tag in its upper bits.
+// It's matched in ProtocolWorker before decoding, so it isn't listed here.
+
+#define SHAX_PROTOCOL_ACTIONS(ACTION) \
+    ACTION(JoinGame,    "join_game",    SHAX_JOIN_GAME_FIELDS) \
+    ACTION(PlacePiece,  "place_piece",  SHAX_PLACE_PIECE_FIELDS) \
+    ACTION(RemovePiece, "remove_piece", SHAX_REMOVE_PIECE_FIELDS) \
+    ACTION(MovePiece,   "move_piece",   SHAX_MOVE_PIECE_FIELDS) \
+    ACTION(QuitGame,    "quit_game",    SHAX_QUIT_GAME_FIELDS) \
+    ACTION(SyncActive,  "sync_active",  SHAX_SYNC_ACTIVE_FIELDS) \
+    ACTION(ResumeGame,  "resume_game",  SHAX_RESUME_GAME_FIELDS)
+
+#define SHAX_JOIN_GAME_FIELDS(FIELD) \
+    FIELD(bool,          success,        "success",         Required) \
+    FIELD(QString,       error,          "error",           Optional) \
+    FIELD(bool,          waiting,        "waiting",         OnSuccess) \
+    FIELD(uint8_t,       playerNum,      "player_num",      Optional) \
+    FIELD(uint,          lobbyKey,       "lobby_key",       Optional) \
+    FIELD(QString,       nextState,      "next_state",      OnSuccess) \
+    FIELD(uint8_t,       nextPlayer,     "next_player",     OnSuccess) \
+    FIELD(BoardTopology, adjacentPieces, "adjacent_pieces", Optional) \
+    FIELD(QString,       topologyHash,   "topology_hash",   Optional) \
+    FIELD(QString,       wireFormat,     "wire_format",     Optional) \
+    FIELD(QString,       resumeToken,    "resume_token",    Optional) \
+    FIELD(uint32_t,      activeSeq,      "active_seq",      Optional)
+
+#define SHAX_PLACE_PIECE_FIELDS(FIELD) \
+    FIELD(bool,          success,        "success",         Required) \
+    FIELD(QString,       error,          "error",           Optional) \
+    FIELD(QString,       nextState,      "next_state",      OnSuccess) \
+    FIELD(uint8_t,       nextPlayer,     "next_player",     OnSuccess) \
+    FIELD(uint16_t,      newPieceId,     "new_piece_ID",    OnSuccess) \
+    FIELD(uint8_t,       x,              "new_x",           OnSuccess) \
+    FIELD(uint8_t,       y,              "new_y",           OnSuccess) \
+    FIELD(PieceList,     activePieces,   "active_pieces",   Optional) \
+    FIELD(PieceList,     activeChanged,  "active_changed",  Optional) \
+    FIELD(uint32_t,      activeSeq,      "active_seq",      Optional)
+
+#define SHAX_REMOVE_PIECE_FIELDS(FIELD) \
+    FIELD(bool,          success,        "success",         Required) \
+    FIELD(QString,       error,          "error",           Optional) \
+    FIELD(QString,       nextState,      "next_state",      OnSuccess) \
+    FIELD(uint8_t,       nextPlayer,     "next_player",     OnSuccess) \
+    FIELD(uint16_t,      removedPiece,   "removed_piece",   OnSuccess) \
+    FIELD(PieceList,     activePieces,   "active_pieces",   Optional) \
+    FIELD(PieceList,     activeChanged,  "active_changed",  Optional) \
+    FIELD(uint32_t,      activeSeq,      "active_seq",      Optional)
+
+#define SHAX_MOVE_PIECE_FIELDS(FIELD) \
+    FIELD(bool,          success,        "success",         Required) \
+    FIELD(QString,       error,          "error",           Optional) \
+    FIELD(QString,       nextState,      "next_state",      OnSuccess) \
+    FIELD(uint8_t,       nextPlayer,     "next_player",     OnSuccess) \
+    FIELD(uint16_t,      movedPiece,     "moved_piece",     Required) \
+    FIELD(uint8_t,       x,              "new_x",           OnSuccess) \
+    FIELD(uint8_t,       y,              "new_y",           OnSuccess) \
+    FIELD(PieceList,     activePieces,   "active_pieces",   Optional) \
+    FIELD(PieceList,     activeChanged,  "active_changed",  Optional) \
+    FIELD(uint32_t,      activeSeq,      "active_seq",      Optional)
+
+#define SHAX_QUIT_GAME_FIELDS(FIELD) \
+    FIELD(bool,          success,        "success",         Required) \
+    FIELD(QString,       error,          "error",           Optional) \
+    FIELD(uint8_t,       winner,         "winner",          Optional) \
+    FIELD(FlagList,      flag,           "flag",            Optional)
+
+// Full copy of the active pieces, sent when the client asks for a resync
+#define SHAX_SYNC_ACTIVE_FIELDS(FIELD) \
+    FIELD(bool,          success,        "success",         Required) \
+    FIELD(QString,       error,          "error",           Optional) \
+    FIELD(PieceList,     activePieces,   "active_pieces",   OnSuccess) \
+    FIELD(uint32_t,      activeSeq,      "active_seq",      Optional)
+
+// Snapshot of a game that was rejoined after the connection dropped.
+// last_request_id is the newest request from this client the server has handled,
+// as the client sent it (with its tag, see ProtocolWorker::clientTag).
+#define SHAX_RESUME_GAME_FIELDS(FIELD) \
+    FIELD(bool,          success,        "success",         Required) \
+    FIELD(QString,       error,          "error",           Optional) \
+    FIELD(QString,       wireFormat,     "wire_format",     Optional) \
+    FIELD(QString,       resumeToken,    "resume_token",    Optional) \
+    FIELD(QString,       nextState,      "next_state",      OnSuccess) \
+    FIELD(uint8_t,       nextPlayer,     "next_player",     OnSuccess) \
+    FIELD(PiecePositions, pieces,        "pieces",          OnSuccess) \
+    FIELD(PieceList,     activePieces,   "active_pieces",   Optional) \
+    FIELD(uint32_t,      activeSeq,      "active_seq",      Optional) \
+    FIELD(qint64,        lastRequestId,  "last_request_id", Optional)
+
+#endif // PROTOCOLSCHEMA_H
@@ -0,0 +1,612 @@
+#include "protocolworker.h"
+#include "tracer.h"
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QCborValue>
+#include <QCborArray>
+#include <QRandomGenerator>
+#include <string.h>
+
+ProtocolWorker::ProtocolWorker(LatencyStats *latency, QObject *parent)
+    : QObject{parent}
+{
+    this->latency = latency;
+    this->clientTag = QRandomGenerator::global()->bounded(1u, 1u << 20);
+}
+
+ProtocolWorker::~ProtocolWorker(){
+    shutdown();
+}
+
+// Creates everything that has to live on the worker thread
+void ProtocolWorker::init(QUrl url){
+    this->url = url;
+
+    settings = new QSettings("SA LLC", "Shax Desktop Client", this);
+    binaryProtocol = settings->value("binary_protocol", true).toBool();
+    activeDelta = settings->value("active_delta", true).toBool();
+
+    websocket = new QWebSocket(QString(), QWebSocketProtocol::VersionLatest, this);
+    QObject::connect(websocket, &QWebSocket::connected, this, &ProtocolWorker::onConnected);
+    QObject::connect(websocket, &QWebSocket::disconnected, this, &ProtocolWorker::onDisconnected);
+    QObject::connect(websocket, &QWebSocket::textMessageReceived, this, &ProtocolWorker::onTextMessageReceived);
+    QObject::connect(websocket, &QWebSocket::binaryMessageReceived, this, &ProtocolWorker::onBinaryMessageReceived);
+    QObject::connect(websocket, &QWebSocket::errorOccurred, this, &ProtocolWorker::error);
+    QObject::connect(websocket, &QWebSocket::pong, this, &ProtocolWorker::onPong);
+
+    reconnectTimer = new QTimer(this);
+    reconnectTimer->setSingleShot(true);
+    QObject::connect(reconnectTimer, &QTimer::timeout, this, &ProtocolWorker::reconnect);
+
+    // Pings measure the network round trip without any server-side game logic
+    pingTimer = new QTimer(this);
+    pingTimer->setInterval(settings->value("debug/ping_interval", 10000).toInt());
+    QObject::connect(pingTimer, &QTimer::timeout, this, &ProtocolWorker::sendPing);
+
+    // Only runs while requests are in flight
+    expiryTimer = new QTimer(this);
+    expiryTimer->setInterval(EXPIRY_INTERVAL);
+    QObject::connect(expiryTimer, &QTimer::timeout, this, &ProtocolWorker::expireRequests);
+
+    // Opens the websocket connection to the shax server.
+    // It's kept open across games and only reopened when the url changes.
+    reconnect();
+}
+
+void ProtocolWorker::configure(QString mode, bool binaryProtocol, bool activeDelta){
+    this->mode = mode;
+    this->binaryProtocol = binaryProtocol;
+    this->activeDelta = activeDelta;
+}
+
+// Reopens the connection if the server url has changed
+void ProtocolWorker::setUrl(QUrl url){
+    if (url == this->url) {
+        return;
+    }
+
+    this->url = url;
+    reconnect();
+}
+
+void ProtocolWorker::reconnect(){
+    // Drop the current connection, if there is one
+    if (websocket->state() != QAbstractSocket::UnconnectedState) {
+        websocket->abort();
+    }
+    status = false;
+
+    // Requests sent on the old connection are lost unless a game is being resumed
+    if (!resuming) {
+        failRequests(inFlight, tr("The connection to the server was reset."));
+    }
+
+    // Every new connection starts with the JSON text protocol
+    wireFormat = WireFormat::JSON;
+
+    websocket->open(url);
+    qDebug() << "Attempting to connect to" << url;
+}
+
+// Opens the connection unless it's already open or opening
+void ProtocolWorker::ensureConnected(){
+    if (websocket->state() == QAbstractSocket::UnconnectedState && !resuming) {
+        reconnect();
+    }
+}
+
+void ProtocolWorker::shutdown(){
+    if (websocket && websocket->state() != QAbstractSocket::UnconnectedState) {
+        websocket->close(QWebSocketProtocol::CloseCodeAbnormalDisconnection);
+        qDebug() << "Closing connection";
+    }
+}
+
+
+// ***************************** REQUESTS ********************************* //
+void ProtocolWorker::sendMessage(QCborMap msg){
+    // Use binary frames once the server has agreed to them
+    if(wireFormat == WireFormat::CBOR)
+        websocket->sendBinaryMessage(dumpCbor(msg));
+    else
+        websocket->sendTextMessage(dumpJson(msg));
+}
+
+// Queues a request, it's sent as soon as the connection is up and there's room in flight
+void ProtocolWorker::sendRequest(uint32_t id, QCborMap msg){
+    QString action = msg.value("action").toString();
+
+    // Let the server skip the board layout if it's already cached
+    // and offer the optional protocol features
+    if (action == "join_game") {
+        QString topologyHash = settings->value("topology_hash").toString();
+        BoardTopology cached;
+        if(!topologyHash.isEmpty() && topologyCache.lookup(topologyHash, cached)) {
+            msg["topology_hash"] = topologyHash;
+        }
+
+        addHandshakeOptions(msg);
+    }
+
+    msg["request_id"] = wireId(id);
+    outbox.append(PendingRequest{id, action, msg});
+    flushOutbox();
+}
+
+void ProtocolWorker::flushOutbox(){
+    // Hold everything back until the connection (and the game) is back
+    if (!status || resuming) {
+        if (!outbox.isEmpty())
+            qDebug() << "Not connected to the server yet, holding" << outbox.size() << "request(s)";
+        return;
+    }
+
+    while (!outbox.isEmpty() && inFlight.size() < MAX_IN_FLIGHT) {
+        PendingRequest request = outbox.takeFirst();
+        startSending(request);
+        inFlight.append(request);
+    }
+}
+
+// Sends a request and starts timing its round trip
+void ProtocolWorker::startSending(PendingRequest &request){
+    Tracer::Scope trace("send", "protocol");
+    trace.setDetail(request.action);
+
+    request.sentAt = LatencyStats::now();
+    sendMessage(request.message);
+
+    if (!expiryTimer->isActive()) {
+        expiryTimer->start();
+    }
+}
+
+// Fails the requests the server never answered, so they don't hold up the
+// in-flight queue. A move made out of turn may get no response at all.
+void ProtocolWorker::expireRequests(){
+    if (inFlight.isEmpty()) {
+        expiryTimer->stop();
+        return;
+    }
+
+    // Requests waiting on a reconnect are timed again when they're replayed
+    if (!status || resuming) {
+        return;
+    }
+
+    const int64_t deadline = LatencyStats::now() - REQUEST_TIMEOUT * 1000000LL;
+    QList<PendingRequest> expired;
+    for (qsizetype i = 0; i < inFlight.size();) {
+        if (inFlight[i].sentAt < deadline) {
+            expired.append(inFlight.takeAt(i));
+        }
+        else {
+            i++;
+        }
+    }
+
+    if (!expired.isEmpty()) {
+        qDebug() << expired.size() << "request(s) timed out";
+        failRequests(expired, tr("The server didn't respond in time."));
+        flushOutbox();
+    }
+}
+
+qint64 ProtocolWorker::wireId(uint32_t id) const{
+    return (qint64(clientTag) << 32) | id;
+}
+
+// Finds the request a response belongs to and removes it from the in-flight queue
+std::optional<ProtocolWorker::PendingRequest> ProtocolWorker::takeRequest(const QCborMap &data){
+    const QCborValue id = data.value("request_id");
+
+    if (id.isInteger() || id.isDouble()) {
+        // Echoes of the opponent's requests carry their tag, not ours
+        const qint64 wire = id.toInteger((qint64)id.toDouble());
+        if ((wire >> 32) != clientTag) {
+            return std::nullopt;
+        }
+
+        for (qsizetype i = 0; i < inFlight.size(); i++) {
+            if (inFlight[i].id == (uint32_t)wire) {
+                return inFlight.takeAt(i);
+            }
+        }
+        return std::nullopt;
+    }
+
+    // Servers that don't echo IDs answer requests in order.
+    // Moves made on the opponent's turn are theirs, not responses to this client.
+    QString action = data.value("action").toString();
+    bool isMove = action == "place_piece" || action == "remove_piece" || action == "move_piece";
+    if (isMove && mode != "Local" && currentTurn != playerNum) {
+        return std::nullopt;
+    }
+
+    for (qsizetype i = 0; i < inFlight.size(); i++) {
+        if (inFlight[i].action == action) {
+            return inFlight.takeAt(i);
+        }
+    }
+    return std::nullopt;
+}
+
+// Answers requests that will never get a response
+void ProtocolWorker::failRequests(QList<PendingRequest> &requests, const QString &error){
+    QList<PendingRequest> failed;
+    failed.swap(requests);
+
+    for (const PendingRequest &request : std::as_const(failed)) {
+        QCborMap response;
+        response["action"] = request.action;
+        response["request_id"] = (qint64)request.id;
+        response["success"] = false;
+        response["error"] = error;
+        emit requestCompleted(request.id, response, LatencyStats::now());
+    }
+}
+
+// Options offered by the client whenever it joins or rejoins a game
+void ProtocolWorker::addHandshakeOptions(QCborMap &data){
+    // Offer the binary encoding, the server picks one in its response
+    if(binaryProtocol) {
+        data["wire_formats"] = QCborArray{"cbor", "json"};
+    }
+
+    // Ask for only the changes to the active pieces after each move
+    if(activeDelta) {
+        data["active_delta"] = true;
+    }
+}
+
+
+// ******************** MESSAGE HELPER FUNCTIONS ************************** //
+QCborMap ProtocolWorker::loadJson(QString msg){
+    QJsonDocument response = QJsonDocument::fromJson(msg.toUtf8());
+    return QCborMap::fromJsonObject(response.object());
+}
+QString ProtocolWorker::dumpJson(QCborMap msg){
+    return QJsonDocument(msg.toJsonObject()).toJson(QJsonDocument::Compact);
+}
+
+QCborMap ProtocolWorker::loadCbor(QByteArray msg){
+    return QCborValue::fromCbor(msg).toMap();
+}
+QByteArray ProtocolWorker::dumpCbor(QCborMap msg){
+    return msg.toCborValue().toCbor();
+}
+
+
+// ********************* WEBSOCKET-RELATED SLOTS **************************** //
+void ProtocolWorker::onConnected(){
+    status = true;
+    emit connected();
+
+    if (pingTimer->interval() > 0) {
+        pingTimer->start();
+    }
+
+    // Rejoin the game that was interrupted
+    if (resuming) {
+        qDebug() << "Reconnected, resuming the game.";
+
+        QCborMap data;
+        data["action"] = "resume_game";
+        data["resume_token"] = resumeToken;
+        addHandshakeOptions(data);
+        sendMessage(data);
+        return;
+    }
+
+    // Send the requests that were waiting on the connection
+    flushOutbox();
+}
+
+void ProtocolWorker::onDisconnected(){
+    qDebug() << "Disconnected from the server.";
+    status = false;
+    pingTimer->stop();
+    emit disconnected();
+
+    // The server closed the connection in the middle of a game
+    if (inGame && !resuming && !resumeToken.isEmpty()) {
+        beginResume();
+    }
+}
+
+void ProtocolWorker::error(QAbstractSocket::SocketError error){
+    qDebug() << "An error has occured:" << error << "\n";
+    status = false;
+
+    // Keep trying while rejoining an interrupted game
+    if (resuming) {
+        scheduleReconnect();
+        return;
+    }
+
+    // Try to rejoin a running game instead of ending it
+    if (inGame && !resumeToken.isEmpty()) {
+        beginResume();
+        return;
+    }
+
+    // Only bother the user if they were waiting on the server
+    bool notify = inGame || !outbox.isEmpty() || !inFlight.isEmpty();
+
+    endLostGame();
+
+    if (!notify) {
+        return;
+    }
+
+    // Handles a lost connection
+    if (error == QAbstractSocket::RemoteHostClosedError) {
+        emit connectionError("Lost the connection to the websocket server. Check your connection and try again.");
+    }
+    else if (error == QAbstractSocket::ConnectionRefusedError){
+        emit connectionError("Couldn't connect to the websocket server.");
+    }
+    else {
+        emit connectionError("An error occured with the connection to the server.");
+    }
+}
+
+// Keeps the current game alive while trying to get the connection back
+void ProtocolWorker::beginResume(){
+    qDebug() << "Lost the connection during a game, trying to resume it.";
+
+    resuming = true;
+    reconnectAttempts = 0;
+    emit connectionInterrupted();
+
+    scheduleReconnect();
+}
+
+// Retries with a jittered exponential backoff
+void ProtocolWorker::scheduleReconnect(){
+    if (reconnectAttempts >= MAX_RECONNECT_ATTEMPTS) {
+        qDebug() << "Giving up on resuming the game.";
+        endLostGame();
+        emit connectionError("Lost the connection to the websocket server. Check your connection and try again.");
+        return;
+    }
+
+    int delay = qMin(RECONNECT_MAX_DELAY, RECONNECT_BASE_DELAY << reconnectAttempts);
+    delay = delay / 2 + QRandomGenerator::global()->bounded(delay / 2 + 1);
+    reconnectAttempts++;
+
+    qDebug() << "Reconnecting in" << delay << "ms (attempt" << reconnectAttempts << ")";
+    reconnectTimer->start(delay);
+}
+
+// Ends a game that can't be continued after losing the connection
+void ProtocolWorker::endLostGame(){
+    resuming = false;
+    resumeToken.clear();
+    failRequests(inFlight, tr("Lost the connection to the server."));
+    failRequests(outbox, tr("Lost the connection to the server."));
+
+    // Create an artificial API response to properly end the current game
+    if (inGame) {
+        inGame = false;
+
+        Protocol::QuitGameResponse response;
+        response.success = true;
+        response.winner = 0;
+        emit quitGameReceived(response);
+    }
+}
+
+void ProtocolWorker::onTextMessageReceived(const QString &msg){
+    int64_t receivedAt = LatencyStats::now();
+    Tracer::Scope trace("receive", "protocol");
+    qDebug() << "Got a response.";
+
+    QCborMap data = loadJson(msg);
+    if (Tracer::isEnabled())
+        trace.setDetail(data.value("action").toString());
+    handleMessage(data, receivedAt);
+}
+
+void ProtocolWorker::onBinaryMessageReceived(const QByteArray &msg){
+    int64_t receivedAt = LatencyStats::now();
+    Tracer::Scope trace("receive", "protocol");
+    qDebug() << "Got a binary response.";
+
+    QCborMap data = loadCbor(msg);
+    if (Tracer::isEnabled())
+        trace.setDetail(data.value("action").toString());
+    handleMessage(data, receivedAt);
+}
+
+// The ping carries its own send time so the round trip is measured in ns, not ms
+void ProtocolWorker::sendPing(){
+    int64_t sentAt = LatencyStats::now();
+    websocket->ping(QByteArray((const char *)&sentAt, sizeof(sentAt)));
+}
+
+void ProtocolWorker::onPong(quint64 elapsedTime, const QByteArray &payload){
+    if (payload.size() != sizeof(int64_t)) {
+        latency->record("ping", (int64_t)elapsedTime * 1000);
+        return;
+    }
+
+    int64_t sentAt;
+    memcpy(&sentAt, payload.constData(), sizeof(sentAt));
+    latency->record("ping", (LatencyStats::now() - sentAt) / 1000);
+}
+
+
+// *************************** RESPONSE HANDLERS **************************** //
+void ProtocolWorker::handleMessage(const QCborMap &data, int64_t receivedAt){
+    // Match the response to its request before the handlers change the game state
+    std::optional<PendingRequest> request = takeRequest(data);
+    if (request) {
+        latency->record(request->action, (receivedAt - request->sentAt) / 1000);
+    }
+
+    switch (Protocol::actionOf(data)) {
+        case Protocol::Action::JoinGame:
+            dispatch(data, &ProtocolWorker::joinGameHandler);
+            break;
+        case Protocol::Action::PlacePiece:
+            dispatch(data, &ProtocolWorker::placePieceHandler);
+            break;
+        case Protocol::Action::RemovePiece:
+            dispatch(data, &ProtocolWorker::removePieceHandler);
+            break;
+        case Protocol::Action::MovePiece:
+            dispatch(data, &ProtocolWorker::movePieceHandler);
+            break;
+        case Protocol::Action::QuitGame:
+            dispatch(data, &ProtocolWorker::quitGameHandler);
+            break;
+        case Protocol::Action::SyncActive:
+            dispatch(data, &ProtocolWorker::syncActiveHandler);
+            break;
+        case Protocol::Action::ResumeGame:
+            dispatch(data, &ProtocolWorker::resumeGameHandler);
+            break;
+        default:
+            qDebug() << "Received unexpected action:" << data.value("action").toString() << "\n";
+    }
+
+    // Time spent parsing and decoding on this thread
+    latency->record(data.value("action").toString() + "/decode", (LatencyStats::now() - receivedAt) / 1000);
+
+    if (request) {
+        emit requestCompleted(request->id, data, receivedAt);
+    }
+
+    // A slot opened up in the in-flight queue
+    flushOutbox();
+}
+
+// Decodes the response and only passes it on to its handler if it's well-formed
+template<typename Response>
+void ProtocolWorker::dispatch(const QCborMap &data, void (ProtocolWorker::*handler)(Response &)){
+    Response response;
+    QString error;
+
+    if (!Protocol::decode(data, response, error)) {
+        qWarning() << "Received a malformed" << data.value("action").toString() << "response:" << error;
+        return;
+    }
+
+    (this->*handler)(response);
+}
+
+void ProtocolWorker::joinGameHandler(Protocol::JoinGameResponse &response){
+    // Switch to the binary encoding if the server accepted it
+    if (response.success && binaryProtocol && response.wireFormat == "cbor") {
+        qDebug() << "Using the binary wire format.";
+        wireFormat = WireFormat::CBOR;
+    }
+
+    // Cache a newly sent board layout or restore the one the server referred to
+    if (response.has(Protocol::JoinGameResponse::Field_adjacentPieces)) {
+        response.topologyHash = TopologyCache::hashOf(response.adjacentPieces);
+        topologyCache.store(response.topologyHash, response.adjacentPieces);
+        settings->setValue("topology_hash", response.topologyHash);
+    }
+    else if (!response.topologyHash.isEmpty() && !topologyCache.lookup(response.topologyHash, response.adjacentPieces)) {
+        qWarning() << "The server referred to an unknown board layout:" << response.topologyHash;
+        response.success = false;
+        response.error = tr("The board layout couldn't be loaded.");
+    }
+
+    if (response.success) {
+        inGame = true;
+        resumeToken = response.resumeToken;
+    }
+    playerNum = response.playerNum;
+    currentTurn = response.nextPlayer;
+
+    emit joinGameReceived(response);
+}
+
+void ProtocolWorker::placePieceHandler(Protocol::PlacePieceResponse &response){
+    currentTurn = response.nextPlayer;
+    emit placePieceReceived(response);
+}
+
+void ProtocolWorker::removePieceHandler(Protocol::RemovePieceResponse &response){
+    currentTurn = response.nextPlayer;
+    emit removePieceReceived(response);
+}
+
+void ProtocolWorker::movePieceHandler(Protocol::MovePieceResponse &response){
+    currentTurn = response.nextPlayer;
+    emit movePieceReceived(response);
+}
+
+void ProtocolWorker::quitGameHandler(Protocol::QuitGameResponse &response){
+    if (response.success) {
+        inGame = false;
+        resumeToken.clear();
+    }
+
+    emit quitGameReceived(response);
+}
+
+void ProtocolWorker::syncActiveHandler(Protocol::SyncActiveResponse &response){
+    emit syncActiveReceived(response);
+}
+
+void ProtocolWorker::resumeGameHandler(Protocol::ResumeGameResponse &response){
+    resuming = false;
+    reconnectAttempts = 0;
+
+    if (!response.success) {
+        qDebug() << "Couldn't resume the game:" << response.error;
+        endLostGame();
+        emit connectionError("Lost the connection to the websocket server. Check your connection and try again.");
+        return;
+    }
+
+    // Switch to the binary encoding if the server accepted it
+    if (binaryProtocol && response.wireFormat == "cbor") {
+        wireFormat = WireFormat::CBOR;
+    }
+
+    if (response.has(Protocol::ResumeGameResponse::Field_resumeToken)) {
+        resumeToken = response.resumeToken;
+    }
+    currentTurn = response.nextPlayer;
+
+    // Requests the server handled before the connection dropped are
+    // already part of the snapshot, but their responses were lost and the
+    // server may have rejected them. They're answered as resumed rather
+    // than successful, the snapshot is what the board is restored from.
+    if (response.has(Protocol::ResumeGameResponse::Field_lastRequestId)) {
+        // Compared on this client's own IDs, a last_request_id with another
+        // tag can't cover any of them
+        const bool ours = (response.lastRequestId >> 32) == clientTag;
+        const uint32_t lastId = (uint32_t)response.lastRequestId;
+
+        for (qsizetype i = 0; ours && i < inFlight.size();) {
+            if (inFlight[i].id > lastId) {
+                i++;
+                continue;
+            }
+
+            PendingRequest request = inFlight.takeAt(i);
+            QCborMap data;
+            data["action"] = request.action;
+            data["request_id"] = (qint64)request.id;
+            data["success"] = false;
+            data["resumed"] = true;
+            data["error"] = tr("The response was lost when the connection dropped, the game was restored from the server.");
+            emit requestCompleted(request.id, data, LatencyStats::now());
+        }
+    }
+
+    emit resumeGameReceived(response);
+
+    // Replay the requests that never made it to the server under their original IDs,
+    // then send anything that was queued while disconnected
+    for (PendingRequest &request : inFlight) {
+        startSending(request);
+    }
+    flushOutbox();
+}
@@ -0,0 +1,152 @@
+#ifndef PROTOCOLWORKER_H
+#define PROTOCOLWORKER_H
+
+#include <QObject>
+#include <QtWebSockets/QWebSocket>
+#include <QSettings>
+#include <QTimer>
+#include <QCborMap>
+#include <QList>
+#include <optional>
+#include <stdint.h>
+#include "protocol.h"
+#include "topologycache.h"
+#include "latencystats.h"
+
+// Encoding used for the messages exchanged with the server
+enum class WireFormat {
+    JSON,
+    CBOR
+};
+
+// Network and protocol layer of the client.
+// Lives on its own thread: owns the websocket, reconnects and resumes games,
+// keeps track of requests and decodes the server's messages into typed
+// responses that are handed to the BoardManager through queued signals.
+class ProtocolWorker : public QObject
+{
+    Q_OBJECT
+public:
+    explicit ProtocolWorker(LatencyStats *latency, QObject *parent = nullptr);
+    ~ProtocolWorker();
+
+public slots:
+    void init(QUrl url);
+    void configure(QString mode, bool binaryProtocol, bool activeDelta);
+    void setUrl(QUrl url);
+    void reconnect();
+    void ensureConnected();
+    void shutdown();
+
+    void sendRequest(uint32_t id, QCborMap msg);
+
+signals:
+    void connected();
+    void disconnected();
+    void connectionError(QString error);
+    void connectionInterrupted();
+
+    // Called once per request with the server's raw response.
+    // receivedAt is the LatencyStats::now() timestamp of its arrival.
+    void requestCompleted(uint32_t id, QCborMap response, int64_t receivedAt);
+
+    void joinGameReceived(Protocol::JoinGameResponse response);
+    void placePieceReceived(Protocol::PlacePieceResponse response);
+    void removePieceReceived(Protocol::RemovePieceResponse response);
+    void movePieceReceived(Protocol::MovePieceResponse response);
+    void quitGameReceived(Protocol::QuitGameResponse response);
+    void syncActiveReceived(Protocol::SyncActiveResponse response);
+    void resumeGameReceived(Protocol::ResumeGameResponse response);
+
+private:
+    // Reconnect backoff, in ms
+    const int RECONNECT_BASE_DELAY = 500;
+    const int RECONNECT_MAX_DELAY = 15000;
+    const int MAX_RECONNECT_ATTEMPTS = 8;
+
+    const int MAX_IN_FLIGHT = 16;
+    // Requests the server hasn't answered by then are failed, in ms
+    const int REQUEST_TIMEOUT = 10000;
+    const int EXPIRY_INTERVAL = 1000;
+
+    // Requests are held until the server responds to them
+    struct PendingRequest {
+        uint32_t id;
+        QString action;
+        QCborMap message;
+        int64_t sentAt = 0;
+    };
+
+    QSettings *settings = nullptr;
+    QWebSocket *websocket = nullptr;
+    QTimer *reconnectTimer = nullptr;
+    QTimer *pingTimer = nullptr;
+    QTimer *expiryTimer = nullptr;
+    LatencyStats *latency;
+    TopologyCache topologyCache;
+
+    QUrl url;
+    QString mode;
+    bool binaryProtocol = true;
+    bool activeDelta = true;
+    WireFormat wireFormat = WireFormat::JSON;
+    bool status = false;
+
+    // Just enough of the game to match responses and resume after a drop
+    bool inGame = false;
+    bool resuming = false;
+    QString resumeToken;
+    int reconnectAttempts = 0;
+    uint8_t currentTurn = 0;
+    uint8_t playerNum = 0;
+
+    // Sent in the upper bits of every request_id. The server echoes IDs in
+    // the moves it broadcasts to both players, the tag tells this client's
+    // responses apart from the opponent's. Kept under 2^52 with the ID, so
+    // it survives servers that store numbers as doubles.
+    uint32_t clientTag;
+
+    QList<PendingRequest> inFlight;
+    QList<PendingRequest> outbox;
+
+    // Websocket events
+    void onConnected();
+    void onDisconnected();
+    void onTextMessageReceived(const QString &msg);
+    void onBinaryMessageReceived(const QByteArray &msg);
+    void error(QAbstractSocket::SocketError error);
+    void onPong(quint64 elapsedTime, const QByteArray &payload);
+    void sendPing();
+
+    void sendMessage(QCborMap msg);
+    void flushOutbox();
+    std::optional<PendingRequest> takeRequest(const QCborMap &data);
+    void failRequests(QList<PendingRequest> &requests, const QString &error);
+    void startSending(PendingRequest &request);
+    void expireRequests();
+    qint64 wireId(uint32_t id) const;
+    void addHandshakeOptions(QCborMap &data);
+
+    void beginResume();
+    void scheduleReconnect();
+    void endLostGame();
+
+    QCborMap loadJson(QString msg);
+    QString dumpJson(QCborMap msg);
+    QCborMap loadCbor(QByteArray msg);
+    QByteArray dumpCbor(QCborMap msg);
+
+    void handleMessage(const QCborMap &data, int64_t receivedAt);
+    template<typename Response>
+    void dispatch(const QCborMap &data, void (ProtocolWorker::*handler)(Response &));
+
+    void joinGameHandler(Protocol::JoinGameResponse &response);
+    void placePieceHandler(Protocol::PlacePieceResponse &response);
+    void removePieceHandler(Protocol::RemovePieceResponse &response);
+    void movePieceHandler(Protocol::MovePieceResponse &response);
+    void quitGameHandler(Protocol::QuitGameResponse &response);
+    void syncActiveHandler(Protocol::SyncActiveResponse &response);
+    void resumeGameHandler(Protocol::ResumeGameResponse &response);
+};
+
+#endif // PROTOCOLWORKER_H
@@ -0,0 +1,193 @@
+#include "renderprofiler.h"
+#include <QFile>
+#include <QTextStream>
+#include <QDateTime>
+#include <algorithm>
+
+bool RenderProfiler::enabled = false;
+QElapsedTimer RenderProfiler::clock;
+RenderProfiler::Frame RenderProfiler::current;
+int64_t RenderProfiler::frameStart = -1;
+int64_t RenderProfiler::lastFrameEnd = -1;
+int RenderProfiler::unmatched = 0;
+QList<RenderProfiler::Frame> RenderProfiler::history;
+int RenderProfiler::next = 0;
+
+int64_t RenderProfiler::now(){
+    return clock.nsecsElapsed();
+}
+
+void RenderProfiler::record(Section section, int64_t ns){
+    current.sections[section] += ns;
+    if (section == PiecePaint || section == BoardPaint) {
+        current.items++;
+    }
+}
+
+
+// ********************************** FRAMES *********************************** //
+void RenderProfiler::beginFrame(){
+    if (!enabled) {
+        return;
+    }
+    if (frameStart >= 0) {
+        unmatched++;
+    }
+    frameStart = now();
+}
+
+void RenderProfiler::endFrame(){
+    if (!enabled) {
+        return;
+    }
+    if (frameStart < 0) {
+        unmatched++;
+        return;
+    }
+
+    const int64_t end = now();
+    current.paint = end - frameStart;
+    current.interval = lastFrameEnd >= 0 ? end - lastFrameEnd : 0;
+
+    if (history.size() < HISTORY_SIZE) {
+        history.append(current);
+    }
+    else {
+        history[next] = current;
+    }
+    next = (next + 1) % HISTORY_SIZE;
+
+    current = Frame();
+    frameStart = -1;
+    lastFrameEnd = end;
+}
+
+int RenderProfiler::unmatchedFrames(){
+    return unmatched;
+}
+
+int RenderProfiler::frameCount(){
+    return history.size();
+}
+
+const RenderProfiler::Frame &RenderProfiler::frame(int age){
+    return history[(next - 1 - age + HISTORY_SIZE) % HISTORY_SIZE];
+}
+
+void RenderProfiler::clear(){
+    history.clear();
+    next = 0;
+    current = Frame();
+    frameStart = -1;
+    lastFrameEnd = -1;
+    unmatched = 0;
+}
+
+const char *RenderProfiler::sectionName(Section section){
+    switch (section) {
+        case PiecePaint:
+            return "pieces";
+        case BoardPaint:
+            return "board";
+        case Animation:
+            return "animation";
+        case Protocol:
+            return "protocol";
+        case SectionCount:
+            break;
+    }
+    return "";
+}
+
+
+// ********************************** SETTINGS *********************************** //
+void RenderProfiler::setEnabled(bool enabled){
+    if (enabled && !clock.isValid()) {
+        clock.start();
+    }
+
+    // Frames only count from when they're fully watched
+    if (enabled != RenderProfiler::enabled) {
+        current = Frame();
+        frameStart = -1;
+        lastFrameEnd = -1;
+    }
+    RenderProfiler::enabled = enabled;
+}
+
+bool RenderProfiler::isEnabled(){
+    return enabled;
+}
+
+
+// ********************************** EXPORT *********************************** //
+bool RenderProfiler::dump(const QString &fileName){
+    const int count = frameCount();
+    if (count == 0) {
+        return true;
+    }
+
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text)) {
+        return false;
+    }
+
+    // The first frame has no interval
+    QList<int64_t> intervals, paints;
+    int64_t totalInterval = 0;
+    uint64_t totalItems = 0;
+    int64_t totalSections[SectionCount] = {};
+    for (int age = 0; age < count; age++) {
+        const Frame &f = frame(age);
+        if (f.interval > 0) {
+            intervals.append(f.interval);
+            totalInterval += f.interval;
+        }
+        paints.append(f.paint);
+        totalItems += f.items;
+        for (int s = 0; s < SectionCount; s++) {
+            totalSections[s] += f.sections[s];
+        }
+    }
+    std::sort(intervals.begin(), intervals.end());
+    std::sort(paints.begin(), paints.end());
+
+    auto percentile = [](const QList<int64_t> &sorted, double p) -> int64_t {
+        return sorted.isEmpty() ? 0 : sorted[qMin(qsizetype(sorted.size() * p), sorted.size() - 1)] / 1000;
+    };
+
+    QTextStream stream(&file);
+    stream << "# Frame times in us, " << QDateTime::currentDateTime().toString(Qt::ISODate) << "\n";
+    stream << "# frames " << count;
+    if (totalInterval > 0) {
+        stream << ", " << QString::number(intervals.size() * 1e9 / totalInterval, 'f', 1) << " fps";
+    }
+    stream << ", " << QString::number(double(totalItems) / count, 'f', 1) << " items/frame";
+    stream << ", " << unmatched << " unmatched\n";
+    stream << "# interval p50 " << percentile(intervals, 0.50) << ", p95 " << percentile(intervals, 0.95)
+           << ", p99 " << percentile(intervals, 0.99) << ", max " << percentile(intervals, 1) << "\n";
+    stream << "# paint p50 " << percentile(paints, 0.50) << ", p95 " << percentile(paints, 0.95)
+           << ", p99 " << percentile(paints, 0.99) << ", max " << percentile(paints, 1) << "\n";
+    stream << "# avg/frame";
+    for (int s = 0; s < SectionCount; s++) {
+        stream << " " << sectionName(Section(s)) << " " << totalSections[s] / count / 1000;
+    }
+    stream << "\n";
+
+    stream << QString("%1 %2 %3 %4").arg("frame", 8).arg("interval", 10).arg("paint", 10).arg("items", 6);
+    for (int s = 0; s < SectionCount; s++) {
+        stream << QString(" %1").arg(sectionName(Section(s)), 10);
+    }
+    stream << "\n";
+
+    // Oldest first
+    for (int age = count - 1, index = 0; age >= 0; age--, index++) {
+        const Frame &f = frame(age);
+        stream << QString("%1 %2 %3 %4").arg(index, 8).arg(f.interval / 1000, 10).arg(f.paint / 1000, 10).arg(f.items, 6);
+        for (int s = 0; s < SectionCount; s++) {
+            stream << QString(" %1").arg(f.sections[s] / 1000, 10);
+        }
+        stream << "\n";
+    }
+    return true;
+}
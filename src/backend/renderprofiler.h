@@ -0,0 +1,92 @@
+#ifndef RENDERPROFILER_H
+#define RENDERPROFILER_H
+
+#include <QString>
+#include <QList>
+#include <QElapsedTimer>
+#include <stdint.h>
+
+// Where the GUI thread's time goes, frame by frame.
+// Code that's worth watching is wrapped in a Scope, its time is added to the
+// frame being built. The board view marks where each frame's paint starts and
+// ends, everything recorded since the previous frame is counted in it.
+// Switched off, a Scope costs a branch. Only used from the GUI thread.
+class RenderProfiler
+{
+public:
+    enum Section {
+        PiecePaint,
+        BoardPaint,
+        Animation,
+        Protocol,
+        SectionCount
+    };
+
+    // Times in ns
+    struct Frame {
+        // Since the end of the previous frame
+        int64_t interval = 0;
+        // Painting the view, including the items
+        int64_t paint = 0;
+        // Items painted
+        uint32_t items = 0;
+        int64_t sections[SectionCount] = {};
+    };
+
+    class Scope
+    {
+    public:
+        explicit Scope(Section section) : section(section), start(enabled ? now() : -1) {}
+        ~Scope() {
+            if (start >= 0)
+                record(section, now() - start);
+        }
+
+        Scope(const Scope &) = delete;
+        Scope &operator=(const Scope &) = delete;
+
+    private:
+        Section section;
+        int64_t start;
+    };
+
+    static void setEnabled(bool enabled);
+    static bool isEnabled();
+
+    static void beginFrame();
+    static void endFrame();
+    // Frames whose end came without a start or whose start came twice.
+    // It stays 0 as long as the view paints in the order the profiler
+    // expects.
+    static int unmatchedFrames();
+
+    // Frames kept, up to HISTORY_SIZE
+    static int frameCount();
+    // 0 is the latest frame
+    static const Frame &frame(int age);
+    static void clear();
+
+    static const char *sectionName(Section section);
+
+    // Writes a summary and every frame kept to a text file
+    static bool dump(const QString &fileName);
+
+private:
+    // About a minute at 60 fps
+    static const int HISTORY_SIZE = 3600;
+
+    static int64_t now();
+    static void record(Section section, int64_t ns);
+
+    static bool enabled;
+    static QElapsedTimer clock;
+    static Frame current;
+    static int64_t frameStart;
+    static int64_t lastFrameEnd;
+    static int unmatched;
+    // Ring buffer, next is where the next frame goes
+    static QList<Frame> history;
+    static int next;
+};
+
+#endif // RENDERPROFILER_H
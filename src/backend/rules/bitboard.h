@@ -0,0 +1,41 @@
+#ifndef RULES_BITBOARD_H
+#define RULES_BITBOARD_H
+
+#include <stdint.h>
+
+namespace Rules {
+
+// One bit per node of the board, in the geometry's canonical node order
+typedef uint32_t Bitboard;
+
+const int MAX_NODES = 32;
+
+inline int popCount(Bitboard b){
+    return __builtin_popcount(b);
+}
+
+// Index of the lowest set bit, b must not be empty
+inline int lowestBit(Bitboard b){
+    return __builtin_ctz(b);
+}
+
+// Index of the highest set bit, b must not be empty
+inline int highestBit(Bitboard b){
+    return 31 - __builtin_clz(b);
+}
+
+// Removes and returns the lowest set bit, for looping over a bitboard:
+//   while (b) { int node = popLowest(b); ... }
+inline int popLowest(Bitboard &b){
+    int node = lowestBit(b);
+    b &= b - 1;
+    return node;
+}
+
+inline Bitboard bitOf(int node){
+    return (Bitboard)1 << node;
+}
+
+} // namespace Rules
+
+#endif // RULES_BITBOARD_H
@@ -0,0 +1,298 @@
+#include "evaluation.h"
+#include <algorithm>
+#include <string.h>
+
+// The vector kernels are compiled for their instruction sets function by
+// function, so the rest of the engine still runs on any x86 CPU
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define RULES_EVAL_X86
+#include <immintrin.h>
+#endif
+
+namespace Rules {
+
+namespace {
+
+const int MAX_LANES = 8;
+
+// Positions of a batch one field at a time, from the side to move's view
+struct Lanes {
+    alignas(32) uint32_t own[MAX_LANES];
+    alignas(32) uint32_t theirs[MAX_LANES];
+    // All ones outside of placement, where mobility counts
+    alignas(32) uint32_t movement[MAX_LANES];
+    // The weighted material, which is cheap to count one by one
+    alignas(32) int32_t base[MAX_LANES];
+};
+
+// A pending removal is as good as a piece
+int materialOf(const Position &position){
+    const int us = position.side;
+    const int them = us ^ 1;
+    int pending = position.phase == Phase::Removal || position.phase == Phase::FirstRemoval ? 1 : 0;
+    return (position.onBoard(us) + position.inHand[us]) - (position.onBoard(them) + position.inHand[them]) + pending;
+}
+
+// Unused lanes are left empty, their scores are thrown away
+void gather(const Position *positions, int count, const EvalWeights &weights, Lanes &lanes){
+    memset(&lanes, 0, sizeof(lanes));
+    for (int i = 0; i < count; i++) {
+        const Position &position = positions[i];
+        lanes.own[i] = position.pieces[position.side];
+        lanes.theirs[i] = position.pieces[position.side ^ 1];
+        lanes.movement[i] = position.phase != Phase::Placement ? ~0u : 0u;
+        lanes.base[i] = weights.material * materialOf(position);
+    }
+}
+
+#ifdef RULES_EVAL_X86
+
+// Bit count of each 32-bit lane: a lookup per nibble, then the four byte
+// counts of a lane are added up by two multiply-adds
+__attribute__((target("sse4.1")))
+inline __m128i popCount4(__m128i v){
+    const __m128i lookup = _mm_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+    const __m128i nibble = _mm_set1_epi8(0x0f);
+    __m128i counts = _mm_add_epi8(_mm_shuffle_epi8(lookup, _mm_and_si128(v, nibble)),
+                                  _mm_shuffle_epi8(lookup, _mm_and_si128(_mm_srli_epi16(v, 4), nibble)));
+    return _mm_madd_epi16(_mm_maddubs_epi16(counts, _mm_set1_epi8(1)), _mm_set1_epi16(1));
+}
+
+__attribute__((target("sse4.1")))
+void evaluateSse41(const Geometry &geometry, const Lanes &lanes, const EvalWeights &weights, int32_t *scores){
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i one = _mm_set1_epi32(1);
+    const __m128i own = _mm_load_si128((const __m128i *)lanes.own);
+    const __m128i theirs = _mm_load_si128((const __m128i *)lanes.theirs);
+    const __m128i empty = _mm_andnot_si128(_mm_or_si128(own, theirs), _mm_set1_epi32((int)geometry.allNodes()));
+
+    __m128i ownMills = zero, theirMills = zero, threats = zero;
+    for (Bitboard m : geometry.mills()) {
+        const __m128i mill = _mm_set1_epi32((int)m);
+        const __m128i ownIn = _mm_and_si128(own, mill);
+        const __m128i theirsIn = _mm_and_si128(theirs, mill);
+        ownMills = _mm_or_si128(ownMills, _mm_and_si128(_mm_cmpeq_epi32(ownIn, mill), mill));
+        theirMills = _mm_or_si128(theirMills, _mm_and_si128(_mm_cmpeq_epi32(theirsIn, mill), mill));
+
+        // Exactly one empty node, comparisons give -1 so threats are subtracted
+        if (weights.threat != 0) {
+            const __m128i open = _mm_and_si128(empty, mill);
+            const __m128i single = _mm_andnot_si128(_mm_cmpeq_epi32(open, zero), _mm_cmpeq_epi32(_mm_and_si128(open, _mm_sub_epi32(open, one)), zero));
+            threats = _mm_sub_epi32(threats, _mm_and_si128(single, _mm_cmpeq_epi32(theirsIn, zero)));
+            threats = _mm_add_epi32(threats, _mm_and_si128(single, _mm_cmpeq_epi32(ownIn, zero)));
+        }
+    }
+
+    __m128i mobility = zero, reach = zero;
+    for (int node = 0; node < geometry.nodeCount(); node++) {
+        const __m128i bit = _mm_set1_epi32((int)bitOf(node));
+        const __m128i adjacent = _mm_set1_epi32((int)geometry.adjacent(node));
+        const __m128i free = popCount4(_mm_and_si128(adjacent, empty));
+        mobility = _mm_add_epi32(mobility, _mm_and_si128(free, _mm_cmpeq_epi32(_mm_and_si128(own, bit), bit)));
+        mobility = _mm_sub_epi32(mobility, _mm_and_si128(free, _mm_cmpeq_epi32(_mm_and_si128(theirs, bit), bit)));
+        if (weights.blocked != 0) {
+            reach = _mm_or_si128(reach, _mm_and_si128(adjacent, _mm_cmpeq_epi32(_mm_and_si128(empty, bit), bit)));
+        }
+    }
+
+    const __m128i mills = _mm_sub_epi32(popCount4(ownMills), popCount4(theirMills));
+    const __m128i blocked = _mm_sub_epi32(popCount4(_mm_andnot_si128(reach, theirs)), popCount4(_mm_andnot_si128(reach, own)));
+
+    __m128i score = _mm_load_si128((const __m128i *)lanes.base);
+    score = _mm_add_epi32(score, _mm_mullo_epi32(mills, _mm_set1_epi32(weights.mill)));
+    score = _mm_add_epi32(score, _mm_mullo_epi32(threats, _mm_set1_epi32(weights.threat)));
+    __m128i late = _mm_add_epi32(_mm_mullo_epi32(mobility, _mm_set1_epi32(weights.mobility)),
+                                 _mm_mullo_epi32(blocked, _mm_set1_epi32(weights.blocked)));
+    score = _mm_add_epi32(score, _mm_and_si128(late, _mm_load_si128((const __m128i *)lanes.movement)));
+    _mm_storeu_si128((__m128i *)scores, score);
+}
+
+// Same as the SSE4.1 kernel, eight lanes wide
+__attribute__((target("avx2")))
+inline __m256i popCount8(__m256i v){
+    const __m256i lookup = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+                                            0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+    const __m256i nibble = _mm256_set1_epi8(0x0f);
+    __m256i counts = _mm256_add_epi8(_mm256_shuffle_epi8(lookup, _mm256_and_si256(v, nibble)),
+                                     _mm256_shuffle_epi8(lookup, _mm256_and_si256(_mm256_srli_epi16(v, 4), nibble)));
+    return _mm256_madd_epi16(_mm256_maddubs_epi16(counts, _mm256_set1_epi8(1)), _mm256_set1_epi16(1));
+}
+
+__attribute__((target("avx2")))
+void evaluateAvx2(const Geometry &geometry, const Lanes &lanes, const EvalWeights &weights, int32_t *scores){
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i one = _mm256_set1_epi32(1);
+    const __m256i own = _mm256_load_si256((const __m256i *)lanes.own);
+    const __m256i theirs = _mm256_load_si256((const __m256i *)lanes.theirs);
+    const __m256i empty = _mm256_andnot_si256(_mm256_or_si256(own, theirs), _mm256_set1_epi32((int)geometry.allNodes()));
+
+    __m256i ownMills = zero, theirMills = zero, threats = zero;
+    for (Bitboard m : geometry.mills()) {
+        const __m256i mill = _mm256_set1_epi32((int)m);
+        const __m256i ownIn = _mm256_and_si256(own, mill);
+        const __m256i theirsIn = _mm256_and_si256(theirs, mill);
+        ownMills = _mm256_or_si256(ownMills, _mm256_and_si256(_mm256_cmpeq_epi32(ownIn, mill), mill));
+        theirMills = _mm256_or_si256(theirMills, _mm256_and_si256(_mm256_cmpeq_epi32(theirsIn, mill), mill));
+
+        if (weights.threat != 0) {
+            const __m256i open = _mm256_and_si256(empty, mill);
+            const __m256i single = _mm256_andnot_si256(_mm256_cmpeq_epi32(open, zero), _mm256_cmpeq_epi32(_mm256_and_si256(open, _mm256_sub_epi32(open, one)), zero));
+            threats = _mm256_sub_epi32(threats, _mm256_and_si256(single, _mm256_cmpeq_epi32(theirsIn, zero)));
+            threats = _mm256_add_epi32(threats, _mm256_and_si256(single, _mm256_cmpeq_epi32(ownIn, zero)));
+        }
+    }
+
+    __m256i mobility = zero, reach = zero;
+    for (int node = 0; node < geometry.nodeCount(); node++) {
+        const __m256i bit = _mm256_set1_epi32((int)bitOf(node));
+        const __m256i adjacent = _mm256_set1_epi32((int)geometry.adjacent(node));
+        const __m256i free = popCount8(_mm256_and_si256(adjacent, empty));
+        mobility = _mm256_add_epi32(mobility, _mm256_and_si256(free, _mm256_cmpeq_epi32(_mm256_and_si256(own, bit), bit)));
+        mobility = _mm256_sub_epi32(mobility, _mm256_and_si256(free, _mm256_cmpeq_epi32(_mm256_and_si256(theirs, bit), bit)));
+        if (weights.blocked != 0) {
+            reach = _mm256_or_si256(reach, _mm256_and_si256(adjacent, _mm256_cmpeq_epi32(_mm256_and_si256(empty, bit), bit)));
+        }
+    }
+
+    const __m256i mills = _mm256_sub_epi32(popCount8(ownMills), popCount8(theirMills));
+    const __m256i blocked = _mm256_sub_epi32(popCount8(_mm256_andnot_si256(reach, theirs)), popCount8(_mm256_andnot_si256(reach, own)));
+
+    __m256i score = _mm256_load_si256((const __m256i *)lanes.base);
+    score = _mm256_add_epi32(score, _mm256_mullo_epi32(mills, _mm256_set1_epi32(weights.mill)));
+    score = _mm256_add_epi32(score, _mm256_mullo_epi32(threats, _mm256_set1_epi32(weights.threat)));
+    __m256i late = _mm256_add_epi32(_mm256_mullo_epi32(mobility, _mm256_set1_epi32(weights.mobility)),
+                                    _mm256_mullo_epi32(blocked, _mm256_set1_epi32(weights.blocked)));
+    score = _mm256_add_epi32(score, _mm256_and_si256(late, _mm256_load_si256((const __m256i *)lanes.movement)));
+    _mm256_storeu_si256((__m256i *)scores, score);
+}
+
+#endif // RULES_EVAL_X86
+
+} // namespace
+
+int evaluate(const Geometry &geometry, const Position &position, const EvalWeights &weights){
+    const Bitboard own = position.pieces[position.side];
+    const Bitboard theirs = position.pieces[position.side ^ 1];
+    const Bitboard empty = position.empty(geometry);
+
+    int mills = popCount(geometry.inMills(own)) - popCount(geometry.inMills(theirs));
+
+    int score = weights.material * materialOf(position) + weights.mill * mills;
+
+    // A mill with one empty node and both others taken by the same player.
+    // Terms that aren't weighted aren't counted, here and in the kernels.
+    if (weights.threat != 0) {
+        int threats = 0;
+        for (Bitboard mill : geometry.mills()) {
+            Bitboard open = mill & empty;
+            if (open == 0 || (open & (open - 1)) != 0)
+                continue;
+            if ((theirs & mill) == 0)
+                threats++;
+            else if ((own & mill) == 0)
+                threats--;
+        }
+        score += weights.threat * threats;
+    }
+
+    // Count each player's free links and the pieces that have none,
+    // a player with every piece blocked loses
+    if (position.phase != Phase::Placement) {
+        int mobility = 0;
+        for (Bitboard b = own; b;)
+            mobility += popCount(geometry.adjacent(popLowest(b)) & empty);
+        for (Bitboard b = theirs; b;)
+            mobility -= popCount(geometry.adjacent(popLowest(b)) & empty);
+
+        score += weights.mobility * mobility;
+
+        if (weights.blocked != 0) {
+            Bitboard reach = 0;
+            for (Bitboard b = empty; b;)
+                reach |= geometry.adjacent(popLowest(b));
+            score += weights.blocked * (popCount(theirs & ~reach) - popCount(own & ~reach));
+        }
+    }
+    return score;
+}
+
+void evaluateBatch(const Geometry &geometry, const Position *positions, int count, const EvalWeights &weights, int *scores){
+    static const EvalKernel kernel = bestEvalKernel();
+    evaluateBatch(geometry, positions, count, weights, scores, kernel);
+}
+
+void evaluateBatch(const Geometry &geometry, const Position *positions, int count, const EvalWeights &weights, int *scores, EvalKernel kernel){
+    if (!isSupported(kernel)) {
+        kernel = EvalKernel::Scalar;
+    }
+
+#ifdef RULES_EVAL_X86
+    if (kernel != EvalKernel::Scalar) {
+        // A lone position is quicker to score on its own
+        const int width = kernel == EvalKernel::Avx2 ? 8 : 4;
+        int first = 0;
+        for (; count - first > 1; first += width) {
+            const int lanes = std::min(width, count - first);
+            Lanes batch;
+            int32_t results[MAX_LANES];
+
+            gather(positions + first, lanes, weights, batch);
+            if (kernel == EvalKernel::Avx2)
+                evaluateAvx2(geometry, batch, weights, results);
+            else
+                evaluateSse41(geometry, batch, weights, results);
+            memcpy(scores + first, results, lanes * sizeof(int32_t));
+        }
+        for (; first < count; first++) {
+            scores[first] = evaluate(geometry, positions[first], weights);
+        }
+        return;
+    }
+#endif
+
+    for (int i = 0; i < count; i++) {
+        scores[i] = evaluate(geometry, positions[i], weights);
+    }
+}
+
+EvalKernel bestEvalKernel(){
+    if (isSupported(EvalKernel::Avx2))
+        return EvalKernel::Avx2;
+    if (isSupported(EvalKernel::Sse41))
+        return EvalKernel::Sse41;
+    return EvalKernel::Scalar;
+}
+
+bool isSupported(EvalKernel kernel){
+    switch (kernel) {
+        case EvalKernel::Scalar:
+            return true;
+#ifdef RULES_EVAL_X86
+        case EvalKernel::Sse41:
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("sse4.1");
+        case EvalKernel::Avx2:
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("avx2");
+#else
+        case EvalKernel::Sse41:
+        case EvalKernel::Avx2:
+            break;
+#endif
+    }
+    return false;
+}
+
+const char *kernelName(EvalKernel kernel){
+    switch (kernel) {
+        case EvalKernel::Scalar:
+            return "scalar";
+        case EvalKernel::Sse41:
+            return "SSE4.1";
+        case EvalKernel::Avx2:
+            return "AVX2";
+    }
+    return "unknown";
+}
+
+} // namespace Rules
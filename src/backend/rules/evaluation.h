@@ -0,0 +1,47 @@
+#ifndef RULES_EVALUATION_H
+#define RULES_EVALUATION_H
+
+#include "position.h"
+
+namespace Rules {
+
+// Weights of the static evaluation, a piece is worth 100
+struct EvalWeights {
+    int material = 100;
+    // Per piece in a completed mill
+    int mill = 20;
+    // Per mill with two of the player's pieces and the third node empty
+    int threat = 0;
+    // Per free link next to a piece, outside of placement
+    int mobility = 5;
+    // Per piece with no empty neighbor, outside of placement
+    int blocked = 0;
+};
+
+// Ways of evaluating many positions at once, each lane is a position
+enum class EvalKernel {
+    Scalar,
+    Sse41,
+    Avx2,
+};
+
+// Static score of a position for the side to move, the game mustn't be over.
+// Material is what matters most, mills, threats and mobility break ties.
+int evaluate(const Geometry &geometry, const Position &position, const EvalWeights &weights = EvalWeights());
+
+// Scores count positions into scores, with the same results as evaluate.
+// Positions are done 8 or 4 at a time with AVX2 or SSE4.1 when the CPU has
+// them, which is checked once.
+void evaluateBatch(const Geometry &geometry, const Position *positions, int count, const EvalWeights &weights, int *scores);
+// Same with a given kernel, for comparing them. Falls back to the scalar
+// one if the CPU doesn't support the kernel.
+void evaluateBatch(const Geometry &geometry, const Position *positions, int count, const EvalWeights &weights, int *scores, EvalKernel kernel);
+
+// Best kernel the CPU supports
+EvalKernel bestEvalKernel();
+bool isSupported(EvalKernel kernel);
+const char *kernelName(EvalKernel kernel);
+
+} // namespace Rules
+
+#endif // RULES_EVALUATION_H
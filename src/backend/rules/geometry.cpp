@@ -0,0 +1,157 @@
+#include "geometry.h"
+#include <algorithm>
+
+namespace Rules {
+
+Geometry Geometry::standard(){
+    std::vector<NodeLinks> nodes;
+
+    auto link = [&nodes](Point a, Point b){
+        for (Point p : {a, b}) {
+            auto it = std::find_if(nodes.begin(), nodes.end(), [p](const NodeLinks &n){ return n.point == p; });
+            if (it == nodes.end()) {
+                nodes.push_back({p, {}});
+            }
+        }
+        for (NodeLinks &n : nodes) {
+            if (n.point == a)
+                n.neighbors.push_back(b);
+            else if (n.point == b)
+                n.neighbors.push_back(a);
+        }
+    };
+
+    // The squares, outermost first
+    for (int s = 0; s < 3; s++) {
+        int lo = s, mid = 3, hi = 6 - s;
+        Point ring[8] = {{lo, lo}, {mid, lo}, {hi, lo}, {hi, mid}, {hi, hi}, {mid, hi}, {lo, hi}, {lo, mid}};
+        for (int i = 0; i < 8; i++) {
+            link(ring[i], ring[(i + 1) % 8]);
+        }
+    }
+
+    // Midpoints and corners joined across the squares
+    for (int s = 0; s < 2; s++) {
+        int lo = s, hi = 6 - s;
+        link({3, lo}, {3, lo + 1});
+        link({hi, 3}, {hi - 1, 3});
+        link({3, hi}, {3, hi - 1});
+        link({lo, 3}, {lo + 1, 3});
+
+        link({lo, lo}, {lo + 1, lo + 1});
+        link({hi, lo}, {hi - 1, lo + 1});
+        link({hi, hi}, {hi - 1, hi - 1});
+        link({lo, hi}, {lo + 1, hi - 1});
+    }
+
+    Geometry geometry;
+    geometry.build(nodes);
+    return geometry;
+}
+
+bool Geometry::build(const std::vector<NodeLinks> &nodes, std::string *error){
+    auto fail = [error](const std::string &msg){
+        if (error)
+            *error = msg;
+        return false;
+    };
+
+    if (nodes.empty() || nodes.size() > MAX_NODES) {
+        return fail("the board must have between 1 and " + std::to_string(MAX_NODES) + " nodes");
+    }
+
+    // Number the nodes canonically
+    std::vector<Point> sorted;
+    for (const NodeLinks &n : nodes) {
+        sorted.push_back(n.point);
+    }
+    std::sort(sorted.begin(), sorted.end());
+    if (std::adjacent_find(sorted.begin(), sorted.end()) != sorted.end()) {
+        return fail("the board lists a node twice");
+    }
+
+    *this = Geometry();
+    count = (int)sorted.size();
+    all = count == MAX_NODES ? ~(Bitboard)0 : bitOf(count) - 1;
+    std::copy(sorted.begin(), sorted.end(), points);
+
+    // Links are made symmetric, the server may only list them one way
+    for (const NodeLinks &n : nodes) {
+        int a = indexOf(n.point);
+        for (Point p : n.neighbors) {
+            int b = indexOf(p);
+            if (b < 0) {
+                return fail("a node is linked to a point that isn't on the board");
+            }
+            if (a == b) {
+                return fail("a node is linked to itself");
+            }
+            adjacency[a] |= bitOf(b);
+            adjacency[b] |= bitOf(a);
+        }
+    }
+
+    // Mills are straight lines of three linked nodes, found from their middle node
+    for (int b = 0; b < count; b++) {
+        for (Bitboard as = adjacency[b]; as;) {
+            int a = popLowest(as);
+            for (Bitboard cs = adjacency[b] & ~((bitOf(a) << 1) - 1); cs;) {
+                int c = popLowest(cs);
+
+                int ax = points[a].x - points[b].x, ay = points[a].y - points[b].y;
+                int cx = points[c].x - points[b].x, cy = points[c].y - points[b].y;
+                bool collinear = ax * cy - ay * cx == 0;
+                bool opposite = ax * cx + ay * cy < 0;
+
+                if (collinear && opposite) {
+                    millList.push_back(bitOf(a) | bitOf(b) | bitOf(c));
+                }
+            }
+        }
+    }
+
+    std::sort(millList.begin(), millList.end());
+    for (Bitboard mill : millList) {
+        for (Bitboard nodesInMill = mill; nodesInMill;) {
+            nodeMills[popLowest(nodesInMill)].push_back(mill);
+        }
+    }
+
+    return true;
+}
+
+int Geometry::indexOf(Point p) const{
+    const Point *end = points + count;
+    const Point *it = std::lower_bound(points, end, p);
+    return it != end && *it == p ? (int)(it - points) : -1;
+}
+
+uint64_t Geometry::key() const{
+    // FNV-1a over every node's links
+    uint64_t hash = 14695981039346656037ull;
+    for (int node = 0; node < count; node++) {
+        for (int i = 0; i < 4; i++) {
+            hash = (hash ^ ((adjacency[node] >> (8 * i)) & 0xff)) * 1099511628211ull;
+        }
+    }
+    return hash;
+}
+
+bool Geometry::formsMill(Bitboard b, int node) const{
+    for (Bitboard mill : nodeMills[node]) {
+        if ((b & mill) == mill)
+            return true;
+    }
+    return false;
+}
+
+Bitboard Geometry::inMills(Bitboard b) const{
+    Bitboard result = 0;
+    for (Bitboard mill : millList) {
+        if ((b & mill) == mill)
+            result |= mill;
+    }
+    return result;
+}
+
+} // namespace Rules
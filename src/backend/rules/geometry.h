@@ -0,0 +1,82 @@
+#ifndef RULES_GEOMETRY_H
+#define RULES_GEOMETRY_H
+
+#include <vector>
+#include <string>
+#include <stdint.h>
+#include "bitboard.h"
+
+namespace Rules {
+
+struct Point {
+    int x = 0;
+    int y = 0;
+
+    bool operator==(const Point &other) const { return x == other.x && y == other.y; }
+    bool operator!=(const Point &other) const { return !(*this == other); }
+    // Canonical order: by row, then by column
+    bool operator<(const Point &other) const { return y != other.y ? y < other.y : x < other.x; }
+};
+
+// A node and the nodes it's connected to, as sent in adjacent_pieces
+struct NodeLinks {
+    Point point;
+    std::vector<Point> neighbors;
+};
+
+// Static description of a board: its nodes, which nodes are adjacent and
+// which triples of nodes form mills. Everything is precomputed as bitboards
+// so the move generator never has to look at coordinates.
+//
+// Nodes are numbered in canonical (y, x) order so the same board always gets
+// the same numbering, whatever order the server listed it in.
+// A mill is any three nodes a-b-c where a and c are both neighbors of b and
+// lie on opposite sides of it on a straight line.
+class Geometry
+{
+public:
+    // The standard Shax board: three nested squares on a 7x7 grid, with the
+    // midpoints and the corners of the squares joined to each other
+    static Geometry standard();
+
+    // Builds the geometry of a board graph.
+    // Returns false and describes the problem in error if it can't be used.
+    bool build(const std::vector<NodeLinks> &nodes, std::string *error = nullptr);
+
+    int nodeCount() const { return count; }
+    Bitboard allNodes() const { return all; }
+
+    // Pieces each player places, half the nodes
+    int piecesPerPlayer() const { return count / 2; }
+
+    Point point(int node) const { return points[node]; }
+    // -1 if the point isn't a node of the board
+    int indexOf(Point p) const;
+
+    Bitboard adjacent(int node) const { return adjacency[node]; }
+
+    const std::vector<Bitboard> &mills() const { return millList; }
+    // Mills that go through a node
+    const std::vector<Bitboard> &millsThrough(int node) const { return nodeMills[node]; }
+
+    // Hash of the links between nodes, everything the rules depend on.
+    // Files made for one board are checked against it.
+    uint64_t key() const;
+
+    // Whether the pieces in b complete a mill through node
+    bool formsMill(Bitboard b, int node) const;
+    // All pieces in b that are part of a completed mill
+    Bitboard inMills(Bitboard b) const;
+
+private:
+    int count = 0;
+    Bitboard all = 0;
+    Point points[MAX_NODES];
+    Bitboard adjacency[MAX_NODES] = {};
+    std::vector<Bitboard> millList;
+    std::vector<Bitboard> nodeMills[MAX_NODES];
+};
+
+} // namespace Rules
+
+#endif // RULES_GEOMETRY_H
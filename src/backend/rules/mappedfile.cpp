@@ -0,0 +1,103 @@
+#include "mappedfile.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace Rules {
+
+MappedFile::~MappedFile(){
+    close();
+}
+
+#ifdef _WIN32
+
+bool MappedFile::open(const std::string &path){
+    close();
+
+    HANDLE handle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_RANDOM_ACCESS, nullptr);
+    if (handle == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(handle, &fileSize) || fileSize.QuadPart == 0) {
+        CloseHandle(handle);
+        return false;
+    }
+
+    HANDLE map = CreateFileMappingA(handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    const void *view = map ? MapViewOfFile(map, FILE_MAP_READ, 0, 0, 0) : nullptr;
+    if (!view) {
+        if (map)
+            CloseHandle(map);
+        CloseHandle(handle);
+        return false;
+    }
+
+    file = handle;
+    mapping = map;
+    bytes = (const uint8_t *)view;
+    length = (size_t)fileSize.QuadPart;
+    return true;
+}
+
+void MappedFile::close(){
+    if (bytes) {
+        UnmapViewOfFile(bytes);
+        CloseHandle(mapping);
+        CloseHandle(file);
+    }
+    bytes = nullptr;
+    length = 0;
+    file = nullptr;
+    mapping = nullptr;
+}
+
+#else
+
+bool MappedFile::open(const std::string &path){
+    close();
+
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size == 0) {
+        ::close(fd);
+        return false;
+    }
+
+    // The mapping stays valid after the descriptor is closed
+    void *view = mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (view == MAP_FAILED) {
+        return false;
+    }
+
+    // Probes jump all over the file, reading ahead would only waste memory
+    madvise(view, (size_t)info.st_size, MADV_RANDOM);
+
+    bytes = (const uint8_t *)view;
+    length = (size_t)info.st_size;
+    return true;
+}
+
+void MappedFile::close(){
+    if (bytes) {
+        munmap((void *)bytes, length);
+    }
+    bytes = nullptr;
+    length = 0;
+}
+
+#endif
+
+} // namespace Rules
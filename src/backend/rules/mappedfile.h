@@ -0,0 +1,39 @@
+#ifndef RULES_MAPPEDFILE_H
+#define RULES_MAPPEDFILE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+namespace Rules {
+
+// Read-only memory map of a whole file.
+// Pages are loaded by the OS as they're touched, so opening is instant
+// whatever the size, and every process mapping the file shares them.
+class MappedFile
+{
+public:
+    MappedFile() = default;
+    ~MappedFile();
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    bool open(const std::string &path);
+    void close();
+
+    bool isOpen() const { return bytes != nullptr; }
+    const uint8_t *data() const { return bytes; }
+    size_t size() const { return length; }
+
+private:
+    const uint8_t *bytes = nullptr;
+    size_t length = 0;
+#ifdef _WIN32
+    void *file = nullptr;
+    void *mapping = nullptr;
+#endif
+};
+
+} // namespace Rules
+
+#endif // RULES_MAPPEDFILE_H
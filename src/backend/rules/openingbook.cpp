@@ -0,0 +1,81 @@
+#include "openingbook.h"
+#include <algorithm>
+#include <string.h>
+
+namespace Rules {
+
+const char OpeningBook::MAGIC[8] = {'S', 'H', 'A', 'X', 'B', 'K', '0', '1'};
+
+bool OpeningBook::open(const std::string &path, const Geometry &geometry){
+    close();
+
+    if (!file.open(path) || file.size() < sizeof(Header)) {
+        file.close();
+        return false;
+    }
+
+    Header header;
+    memcpy(&header, file.data(), sizeof(Header));
+    // Divided rather than multiplied, a corrupt count would overflow
+    if (memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.geometryKey != geometry.key()
+        || header.entries > (file.size() - sizeof(Header)) / sizeof(Entry)) {
+        file.close();
+        return false;
+    }
+
+    // The header keeps the entries 8-byte aligned
+    entries = (const Entry *)(file.data() + sizeof(Header));
+    count = header.entries;
+    return true;
+}
+
+void OpeningBook::close(){
+    file.close();
+    entries = nullptr;
+    count = 0;
+}
+
+std::vector<OpeningBook::Entry> OpeningBook::lookup(const Geometry &geometry, const Position &position) const{
+    std::vector<Entry> moves;
+    if (!entries || position.phase != Phase::Placement) {
+        return moves;
+    }
+
+    // Don't trust a key that may have been left stale by hand edits
+    Position keyed = position;
+    keyed.rehash();
+
+    const Entry *end = entries + count;
+    const Entry *it = std::lower_bound(entries, end, keyed.key, [](const Entry &entry, uint64_t key){
+        return entry.key < key;
+    });
+
+    // Another position with the same key would only have illegal moves here
+    for (; it != end && it->key == keyed.key; ++it) {
+        if (it->weight > 0 && isLegal(geometry, position, Move::fromRaw(it->move)))
+            moves.push_back(*it);
+    }
+    return moves;
+}
+
+Move OpeningBook::pick(const Geometry &geometry, const Position &position, uint32_t random) const{
+    std::vector<Entry> moves = lookup(geometry, position);
+
+    uint32_t total = 0;
+    for (const Entry &entry : moves) {
+        total += entry.weight;
+    }
+    if (total == 0) {
+        return Move();
+    }
+
+    uint32_t target = random % total;
+    for (const Entry &entry : moves) {
+        if (target < entry.weight)
+            return Move::fromRaw(entry.move);
+        target -= entry.weight;
+    }
+    return Move();
+}
+
+} // namespace Rules
@@ -0,0 +1,56 @@
+#ifndef RULES_OPENINGBOOK_H
+#define RULES_OPENINGBOOK_H
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include "position.h"
+#include "mappedfile.h"
+
+namespace Rules {
+
+// Placement phase moves known to be good, as written by shax-book.
+//
+// The file is a small header followed by an array of entries sorted by
+// position key and then by move. A lookup is a binary search for the key,
+// which gives every book move of the position next to each other. The file
+// is memory mapped, so opening it costs nothing.
+class OpeningBook
+{
+public:
+    struct Header {
+        char magic[8];
+        uint64_t geometryKey;
+        uint64_t entries;
+    };
+    struct Entry {
+        uint64_t key;
+        uint16_t move;
+        // How much the move is played, relative to the others in the position
+        uint16_t weight;
+        uint32_t reserved;
+    };
+    static const char MAGIC[8];
+
+    // Returns false if the file is missing or was made for another board
+    bool open(const std::string &path, const Geometry &geometry);
+    void close();
+    bool isOpen() const { return entries != nullptr; }
+    uint64_t size() const { return count; }
+
+    // Book moves of a position that are legal in it
+    std::vector<Entry> lookup(const Geometry &geometry, const Position &position) const;
+
+    // A book move picked at random in proportion to its weight, or an empty
+    // move if the position isn't in the book. random is any 32-bit value.
+    Move pick(const Geometry &geometry, const Position &position, uint32_t random) const;
+
+private:
+    MappedFile file;
+    const Entry *entries = nullptr;
+    uint64_t count = 0;
+};
+
+} // namespace Rules
+
+#endif // RULES_OPENINGBOOK_H
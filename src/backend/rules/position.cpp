@@ -0,0 +1,177 @@
+#include "position.h"
+#include "zobrist.h"
+
+namespace Rules {
+
+Position Position::start(const Geometry &geometry, uint8_t firstPlayer){
+    Position position;
+    position.inHand[0] = (uint8_t)geometry.piecesPerPlayer();
+    position.inHand[1] = (uint8_t)geometry.piecesPerPlayer();
+    position.side = firstPlayer;
+    position.rehash();
+    return position;
+}
+
+void Position::rehash(){
+    key = stateKey(*this);
+    for (int player = 0; player < 2; player++) {
+        for (Bitboard b = pieces[player]; b;) {
+            key ^= ZOBRIST.pieces[player][popLowest(b)];
+        }
+    }
+}
+
+uint64_t stateKey(const Position &position){
+    return ZOBRIST.state[(int)position.phase][position.side & 1]
+         ^ ZOBRIST.inHand[0][position.inHand[0] % (MAX_NODES + 1)]
+         ^ ZOBRIST.inHand[1][position.inHand[1] % (MAX_NODES + 1)]
+         ^ ZOBRIST.firstJare[position.firstJare + 1];
+}
+
+bool Position::operator==(const Position &other) const{
+    return pieces[0] == other.pieces[0] && pieces[1] == other.pieces[1]
+        && inHand[0] == other.inHand[0] && inHand[1] == other.inHand[1]
+        && side == other.side && phase == other.phase
+        && firstJare == other.firstJare && winner == other.winner;
+}
+
+Bitboard removablePieces(const Geometry &geometry, const Position &position){
+    Bitboard opponent = position.pieces[position.side ^ 1];
+    Bitboard unprotected = opponent & ~geometry.inMills(opponent);
+
+    // Pieces in mills can only be taken when there's nothing else
+    return unprotected ? unprotected : opponent;
+}
+
+void generateMoves(const Geometry &geometry, const Position &position, MoveList &moves){
+    switch (position.phase) {
+        case Phase::Placement:
+            for (Bitboard targets = position.empty(geometry); targets;) {
+                moves.add(Move::place(popLowest(targets)));
+            }
+            break;
+
+        case Phase::FirstRemoval:
+        case Phase::Removal:
+            for (Bitboard targets = removablePieces(geometry, position); targets;) {
+                moves.add(Move::remove(popLowest(targets)));
+            }
+            break;
+
+        case Phase::Movement: {
+            Bitboard empty = position.empty(geometry);
+            for (Bitboard own = position.pieces[position.side]; own;) {
+                int from = popLowest(own);
+                for (Bitboard targets = geometry.adjacent(from) & empty; targets;) {
+                    moves.add(Move::slide(from, popLowest(targets)));
+                }
+            }
+            break;
+        }
+
+        case Phase::Over:
+            break;
+    }
+}
+
+bool isLegal(const Geometry &geometry, const Position &position, Move move){
+    Bitboard empty = position.empty(geometry);
+
+    switch (position.phase) {
+        case Phase::Placement:
+            return move.type() == Move::Place && move.to() < geometry.nodeCount()
+                && (empty & bitOf(move.to()));
+
+        case Phase::FirstRemoval:
+        case Phase::Removal:
+            return move.type() == Move::Remove && move.from() < geometry.nodeCount()
+                && (removablePieces(geometry, position) & bitOf(move.from()));
+
+        case Phase::Movement:
+            return move.type() == Move::Slide && move.from() < geometry.nodeCount() && move.to() < geometry.nodeCount()
+                && (position.pieces[position.side] & bitOf(move.from()))
+                && (geometry.adjacent(move.from()) & empty & bitOf(move.to()));
+
+        case Phase::Over:
+            return false;
+    }
+    return false;
+}
+
+namespace {
+
+// Ends the game if the side to move has lost
+void checkOver(const Geometry &geometry, Position &position){
+    if (position.phase != Phase::Movement) {
+        return;
+    }
+
+    Bitboard own = position.pieces[position.side];
+    bool blocked = true;
+    for (Bitboard b = own; b && blocked;) {
+        blocked = !(geometry.adjacent(popLowest(b)) & position.empty(geometry));
+    }
+
+    if (popCount(own) <= Position::MIN_PIECES || blocked) {
+        position.phase = Phase::Over;
+        position.winner = (int8_t)(position.side ^ 1);
+    }
+}
+
+} // namespace
+
+Position play(const Geometry &geometry, const Position &position, Move move){
+    Position next = position;
+    const int side = position.side;
+
+    switch (move.type()) {
+        case Move::Place:
+            next.pieces[side] |= bitOf(move.to());
+            next.key ^= ZOBRIST.pieces[side][move.to()];
+            next.inHand[side]--;
+
+            if (next.firstJare < 0 && geometry.formsMill(next.pieces[side], move.to())) {
+                next.firstJare = (int8_t)side;
+            }
+
+            // Once everything is placed, the first player to make a mill removes first
+            if (next.inHand[0] == 0 && next.inHand[1] == 0) {
+                next.phase = Phase::FirstRemoval;
+                next.side = next.firstJare < 0 ? 0 : (uint8_t)next.firstJare;
+            }
+            else {
+                next.side = (uint8_t)(side ^ 1);
+            }
+            break;
+
+        case Move::Remove:
+            next.pieces[side ^ 1] &= ~bitOf(move.from());
+            next.key ^= ZOBRIST.pieces[side ^ 1][move.from()];
+            next.phase = Phase::Movement;
+            next.side = (uint8_t)(side ^ 1);
+            break;
+
+        case Move::Slide:
+            next.pieces[side] ^= bitOf(move.from()) | bitOf(move.to());
+            next.key ^= ZOBRIST.pieces[side][move.from()] ^ ZOBRIST.pieces[side][move.to()];
+
+            if (geometry.formsMill(next.pieces[side], move.to())) {
+                next.phase = Phase::Removal;
+            }
+            else {
+                next.side = (uint8_t)(side ^ 1);
+            }
+            break;
+
+        case Move::None:
+            return next;
+    }
+
+    checkOver(geometry, next);
+
+    // The pieces were hashed as they changed, the rest is cheaper to swap whole
+    next.key ^= stateKey(position) ^ stateKey(next);
+    return next;
+}
+
+} // namespace Rules
@@ -0,0 +1,134 @@
+#ifndef RULES_POSITION_H
+#define RULES_POSITION_H
+
+#include <stdint.h>
+#include "bitboard.h"
+#include "geometry.h"
+
+namespace Rules {
+
+// Mirrors the server's game states
+enum class Phase : uint8_t {
+    Placement,
+    FirstRemoval,
+    Removal,
+    Movement,
+    Over
+};
+
+// A move packed into 16 bits: the type, the node it comes from and the node it goes to.
+// Placements only use "to", removals only use "from".
+class Move
+{
+public:
+    enum Type : uint8_t {
+        None,
+        Place,
+        Remove,
+        Slide
+    };
+
+    Move() = default;
+    static Move place(int to) { return Move(Place, NO_NODE, to); }
+    static Move remove(int from) { return Move(Remove, from, NO_NODE); }
+    static Move slide(int from, int to) { return Move(Slide, from, to); }
+    static Move fromRaw(uint16_t bits) { Move move; move.bits = bits; return move; }
+
+    Type type() const { return (Type)(bits >> 12); }
+    int from() const { return (bits >> 6) & 0x3f; }
+    int to() const { return bits & 0x3f; }
+    uint16_t raw() const { return bits; }
+
+    bool operator==(const Move &other) const { return bits == other.bits; }
+    bool operator!=(const Move &other) const { return bits != other.bits; }
+
+    static const int NO_NODE = 0x3f;
+
+private:
+    uint16_t bits = 0;
+
+    Move(Type type, int from, int to) : bits((uint16_t)(type << 12 | from << 6 | to)) {}
+};
+
+// Fixed-size list so move generation never allocates
+class MoveList
+{
+public:
+    // Every node empty (placement) or every link used in both directions can't
+    // exceed this on a board of MAX_NODES nodes with the degrees boards have
+    static const int CAPACITY = 256;
+
+    void add(Move move) { moves[size_++] = move; }
+    void clear() { size_ = 0; }
+    int size() const { return size_; }
+    bool isEmpty() const { return size_ == 0; }
+
+    Move operator[](int i) const { return moves[i]; }
+    const Move *begin() const { return moves; }
+    const Move *end() const { return moves + size_; }
+
+private:
+    Move moves[CAPACITY];
+    int size_ = 0;
+};
+
+// State of a game: one bitboard per player plus the counters the rules need.
+// Players are 0 and 1. It's small enough to be copied for every move.
+//
+// The rules followed are the server's:
+//  - Players take turns placing pieces until both have placed all of theirs.
+//    Mills made while placing don't remove anything, but the first player to
+//    make one (the first "jare") gets to remove first once the board is full.
+//  - FirstRemoval: that player (player 0 if nobody made a mill) removes one of
+//    the opponent's pieces, then the opponent makes the first move.
+//  - Movement: pieces slide along links to empty nodes. Completing a mill
+//    gives the mover a Removal.
+//  - Removal: a piece of the opponent's that isn't in a mill, or any piece if
+//    they're all in mills.
+//  - A player loses when they're down to MIN_PIECES pieces or can't move.
+struct Position
+{
+    static const int MIN_PIECES = 2;
+
+    Bitboard pieces[2] = {0, 0};
+    uint8_t inHand[2] = {0, 0};
+    uint8_t side = 0;
+    Phase phase = Phase::Placement;
+    // Player that made the first mill, -1 if nobody has yet
+    int8_t firstJare = -1;
+    // Set when the game is over, -1 otherwise
+    int8_t winner = -1;
+    // Zobrist key of everything above, kept up to date by start() and play().
+    // Code that sets the fields by hand has to call rehash() afterwards.
+    uint64_t key = 0;
+
+    // Starting position with every piece in hand
+    static Position start(const Geometry &geometry, uint8_t firstPlayer = 0);
+
+    Bitboard occupied() const { return pieces[0] | pieces[1]; }
+    Bitboard empty(const Geometry &geometry) const { return geometry.allNodes() & ~occupied(); }
+    int onBoard(int player) const { return popCount(pieces[player]); }
+
+    // Recomputes the key from scratch
+    void rehash();
+
+    bool operator==(const Position &other) const;
+};
+
+// Appends the legal moves of the side to move
+void generateMoves(const Geometry &geometry, const Position &position, MoveList &moves);
+
+// Key of everything but the pieces on the board
+uint64_t stateKey(const Position &position);
+
+// Pieces the side to move may remove
+Bitboard removablePieces(const Geometry &geometry, const Position &position);
+
+bool isLegal(const Geometry &geometry, const Position &position, Move move);
+
+// Plays a legal move, nothing is checked
+Position play(const Geometry &geometry, const Position &position, Move move);
+
+} // namespace Rules
+
+#endif // RULES_POSITION_H
@@ -0,0 +1,409 @@
+#include "search.h"
+#include <algorithm>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <string.h>
+
+namespace Rules {
+
+Search::Search(const Geometry &geometry, TranspositionTable *table)
+    : geometry(geometry), table(table)
+{
+}
+
+namespace {
+
+// Wins are stored relative to the position rather than the root,
+// so they stay right when the position is reached at another ply
+int scoreToTable(int score, int ply){
+    if (score >= Search::WIN_BOUND)
+        return score + ply;
+    if (score <= -Search::WIN_BOUND)
+        return score - ply;
+    return score;
+}
+
+int scoreFromTable(int score, int ply){
+    if (score >= Search::WIN_BOUND)
+        return score - ply;
+    if (score <= -Search::WIN_BOUND)
+        return score + ply;
+    return score;
+}
+
+} // namespace
+
+int Search::evaluate(const Geometry &geometry, const Position &position, const EvalWeights &weights){
+    if (position.phase == Phase::Over) {
+        return position.winner == position.side ? WIN : -WIN;
+    }
+    return Rules::evaluate(geometry, position, weights);
+}
+
+SearchResult Search::run(const Position &position, const SearchLimits &searchLimits){
+    // The tablebase already knows every child's score
+    SearchLimits limits = searchLimits;
+    if (tablebase && tablebase->covers(position)) {
+        limits.maxDepth = 1;
+        limits.threads = 1;
+    }
+
+    prepare(limits);
+
+    // Don't trust a key that may have been left stale by hand edits
+    Position root = position;
+    root.rehash();
+
+    if (table) {
+        table->newSearch();
+    }
+
+    SearchResult result;
+
+    MoveList rootMoves;
+    generateMoves(geometry, root, rootMoves);
+    if (rootMoves.isEmpty()) {
+        return result;
+    }
+
+    // Nothing to think about
+    if (rootMoves.size() == 1) {
+        result.best = rootMoves[0];
+        result.depth = 1;
+        return result;
+    }
+
+    // Helpers search until the main thread is done, on their own clock-free limits
+    const int helperCount = table ? std::max(limits.threads, 1) - 1 : 0;
+    std::vector<std::unique_ptr<Search>> helpers;
+    std::vector<SearchResult> helperResults(helperCount);
+    std::vector<std::thread> threads;
+
+    SearchLimits helperLimits;
+    helperLimits.maxDepth = limits.maxDepth;
+    helperLimits.timeMs = 0;
+
+    for (int i = 0; i < helperCount; i++) {
+        helpers.push_back(std::make_unique<Search>(geometry, table));
+        helpers[i]->setTablebase(tablebase);
+        helpers[i]->setWeights(weights);
+        helpers[i]->prepare(helperLimits);
+    }
+    for (int i = 0; i < helperCount; i++) {
+        threads.emplace_back([&, i]{
+            helperResults[i] = helpers[i]->iterate(root, rootMoves[0], 1 + (i + 1) % 2);
+        });
+    }
+
+    result = iterate(root, rootMoves[0], 1);
+
+    for (int i = 0; i < helperCount; i++) {
+        helpers[i]->stop();
+        threads[i].join();
+    }
+
+    // A helper that got a full iteration deeper has the better move
+    for (const SearchResult &helperResult : helperResults) {
+        if (helperResult.depth > result.depth) {
+            result.best = helperResult.best;
+            result.score = helperResult.score;
+            result.depth = helperResult.depth;
+        }
+        result.nodes += helperResult.nodes;
+        result.ttProbes += helperResult.ttProbes;
+        result.ttHits += helperResult.ttHits;
+        result.tbHits += helperResult.tbHits;
+    }
+
+    result.timeMs = elapsedMs();
+    return result;
+}
+
+void Search::prepare(const SearchLimits &limits){
+    this->limits = limits;
+    startTime = std::chrono::steady_clock::now();
+    stopped.store(false, std::memory_order_relaxed);
+    nodes = 0;
+    ttProbes = 0;
+    ttHits = 0;
+    tbHits = 0;
+
+    memset(killers, 0, sizeof(killers));
+    memset(history, 0, sizeof(history));
+    memset(pvLength, 0, sizeof(pvLength));
+    batchTop = 0;
+}
+
+SearchResult Search::iterate(const Position &root, Move fallback, int firstDepth){
+    SearchResult result;
+    result.best = fallback;
+
+    for (int depth = firstDepth; depth <= std::min(limits.maxDepth, MAX_PLY - 1); depth++) {
+        int score = negamax(root, depth, -WIN - 1, WIN + 1, 0, true);
+
+        // An iteration cut short is thrown away, the last complete one stands
+        if (stopped.load(std::memory_order_relaxed)) {
+            break;
+        }
+
+        result.best = pv[0][0];
+        result.score = score;
+        result.depth = depth;
+
+        // No point searching deeper once the game is decided
+        if (std::abs(score) >= WIN_BOUND) {
+            break;
+        }
+    }
+
+    result.nodes = nodes;
+    result.ttProbes = ttProbes;
+    result.ttHits = ttHits;
+    result.tbHits = tbHits;
+    return result;
+}
+
+int Search::negamax(const Position &position, int depth, int alpha, int beta, int ply, bool followPv){
+    pvLength[ply] = 0;
+    nodes++;
+
+    if ((nodes % CHECK_INTERVAL) == 0 && outOfTime()) {
+        stopped.store(true, std::memory_order_relaxed);
+    }
+    if (stopped.load(std::memory_order_relaxed)) {
+        return 0;
+    }
+
+    if (position.phase == Phase::Over) {
+        return position.winner == position.side ? WIN - ply : -(WIN - ply);
+    }
+
+    // Exact scores, the game ends plies moves from here
+    TablebaseResult known;
+    if (tablebase && ply > 0 && tablebase->probe(position, known)) {
+        tbHits++;
+        if (known.outcome == 0)
+            return 0;
+        int score = WIN - (ply + known.plies);
+        return known.outcome > 0 ? score : -score;
+    }
+
+    // Removals are searched even at the horizon, they're forced and few
+    bool removing = position.phase == Phase::Removal || position.phase == Phase::FirstRemoval;
+    if ((depth <= 0 && !removing) || ply >= MAX_PLY - 1) {
+        return evaluate(geometry, position, weights);
+    }
+
+    // A result that's deep enough answers the position without searching it
+    Move ttMove;
+    if (table) {
+        TTEntry entry;
+        ttProbes++;
+        if (table->probe(position.key, entry)) {
+            ttHits++;
+            ttMove = entry.move;
+
+            int score = scoreFromTable(entry.score, ply);
+            bool usable = entry.bound == Bound::Exact
+                       || (entry.bound == Bound::Lower && score >= beta)
+                       || (entry.bound == Bound::Upper && score <= alpha);
+            if (ply > 0 && entry.depth >= depth && usable) {
+                return score;
+            }
+        }
+    }
+
+    MoveList moves;
+    generateMoves(geometry, position, moves);
+    if (moves.isEmpty()) {
+        return -(WIN - ply);
+    }
+
+    Move pvMove = followPv && pvLength[0] > ply ? pv[0][ply] : Move();
+    orderMoves(position, moves, ply, pvMove, ttMove);
+
+    // Next to the horizon most children only need their static score. The
+    // first one is often enough for a cutoff so it's scored alone, the rest
+    // are played and scored together once the loop gets to them.
+    const bool frontier = depth <= 1;
+    const size_t first = batchTop;
+    int scored = 0;
+    if (frontier) {
+        if (batch.size() < first + moves.size()) {
+            batch.resize(first + moves.size());
+            batchScores.resize(first + moves.size());
+        }
+        batchTop += moves.size();
+    }
+
+    const int originalAlpha = alpha;
+    Move bestMove;
+    int best = -WIN - 1;
+    for (int i = 0; i < moves.size(); i++) {
+        Move move = moves[i];
+        if (frontier && i == scored) {
+            scored = i == 0 ? 1 : std::min(i + EVAL_BATCH, moves.size());
+            for (int j = i; j < scored; j++) {
+                batch[first + j] = play(geometry, position, moves[j]);
+            }
+            evaluateBatch(geometry, &batch[first + i], scored - i, weights, &batchScores[first + i]);
+        }
+        Position next = frontier ? batch[first + i] : play(geometry, position, move);
+
+        const bool sameSide = next.side == position.side;
+        const int childDepth = childDepthOf(position, next, depth);
+        int score;
+        if (frontier && atHorizon(next, childDepth, ply + 1)) {
+            // What the child's own call would do
+            pvLength[ply + 1] = 0;
+            if ((++nodes % CHECK_INTERVAL) == 0 && outOfTime()) {
+                stopped.store(true, std::memory_order_relaxed);
+            }
+            score = sameSide ? batchScores[first + i] : -batchScores[first + i];
+        }
+        else if (sameSide) {
+            score = negamax(next, childDepth, alpha, beta, ply + 1, followPv && move == pvMove);
+        }
+        else {
+            score = -negamax(next, childDepth, -beta, -alpha, ply + 1, followPv && move == pvMove);
+        }
+
+        if (stopped.load(std::memory_order_relaxed)) {
+            batchTop = first;
+            return 0;
+        }
+
+        if (score > best) {
+            best = score;
+            bestMove = move;
+
+            // Extend the best line with the child's
+            pv[ply][0] = move;
+            memcpy(&pv[ply][1], &pv[ply + 1][0], pvLength[ply + 1] * sizeof(Move));
+            pvLength[ply] = pvLength[ply + 1] + 1;
+        }
+
+        if (score > alpha) {
+            alpha = score;
+        }
+
+        if (alpha >= beta) {
+            // Remember quiet moves that refuted this position
+            if (move.type() != Move::Remove) {
+                if (killers[ply][0] != move) {
+                    killers[ply][1] = killers[ply][0];
+                    killers[ply][0] = move;
+                }
+                history[position.side][move.from() & 0x1f][move.to() & 0x1f] += depth * depth;
+            }
+            break;
+        }
+    }
+
+    batchTop = first;
+
+    if (table) {
+        Bound bound = best >= beta ? Bound::Lower : best > originalAlpha ? Bound::Exact : Bound::Upper;
+        table->store(position.key, bestMove, scoreToTable(best, ply), depth, bound);
+    }
+
+    return best;
+}
+
+// The same side plays again after making a mill, and that removal is free
+int Search::childDepthOf(const Position &position, const Position &child, int depth){
+    return child.side == position.side && child.phase == Phase::Removal ? depth : depth - 1;
+}
+
+bool Search::atHorizon(const Position &child, int depth, int ply) const{
+    if (child.phase == Phase::Over || (tablebase && tablebase->covers(child))) {
+        return false;
+    }
+    bool removing = child.phase == Phase::Removal || child.phase == Phase::FirstRemoval;
+    return (depth <= 0 && !removing) || ply >= MAX_PLY - 1;
+}
+
+// Sorts the moves so the likely best ones are searched first
+void Search::orderMoves(const Position &position, MoveList &moves, int ply, Move pvMove, Move ttMove){
+    int scores[MoveList::CAPACITY];
+    Move sorted[MoveList::CAPACITY];
+    const int side = position.side;
+    const Bitboard own = position.pieces[side];
+    const Bitboard theirs = position.pieces[side ^ 1];
+
+    for (int i = 0; i < moves.size(); i++) {
+        Move move = moves[i];
+        int score = 0;
+
+        if (move == pvMove) {
+            score = 1 << 30;
+        }
+        else if (move == ttMove) {
+            score = 1 << 29;
+        }
+        else if (move.type() == Move::Remove) {
+            // Break up the opponent's almost-mills first
+            Bitboard rest = theirs & ~bitOf(move.from());
+            for (Bitboard mill : geometry.millsThrough(move.from())) {
+                if (popCount(rest & mill) == 2)
+                    score += 1000;
+            }
+        }
+        else {
+            Bitboard after = move.type() == Move::Slide ? (own & ~bitOf(move.from())) | bitOf(move.to()) : own | bitOf(move.to());
+
+            if (geometry.formsMill(after, move.to())) {
+                score = 1 << 28;
+            }
+            else if (move == killers[ply][0]) {
+                score = 1 << 26;
+            }
+            else if (move == killers[ply][1]) {
+                score = 1 << 25;
+            }
+            else {
+                score = history[side][move.from() & 0x1f][move.to() & 0x1f];
+
+                // Block the opponent's mills
+                if (geometry.formsMill(theirs | bitOf(move.to()), move.to()))
+                    score += 1 << 24;
+            }
+        }
+
+        scores[i] = score;
+        sorted[i] = move;
+    }
+
+    // Insertion sort, the lists are short
+    for (int i = 1; i < moves.size(); i++) {
+        int score = scores[i];
+        Move move = sorted[i];
+        int j = i - 1;
+        for (; j >= 0 && scores[j] < score; j--) {
+            scores[j + 1] = scores[j];
+            sorted[j + 1] = sorted[j];
+        }
+        scores[j + 1] = score;
+        sorted[j + 1] = move;
+    }
+
+    const int count = moves.size();
+    moves.clear();
+    for (int i = 0; i < count; i++) {
+        moves.add(sorted[i]);
+    }
+}
+
+bool Search::outOfTime(){
+    if (limits.maxNodes > 0 && nodes >= limits.maxNodes) {
+        return true;
+    }
+    return limits.timeMs > 0 && elapsedMs() >= limits.timeMs;
+}
+
+int64_t Search::elapsedMs() const{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - startTime).count();
+}
+
+} // namespace Rules
@@ -0,0 +1,125 @@
+#ifndef RULES_SEARCH_H
+#define RULES_SEARCH_H
+
+#include <atomic>
+#include <chrono>
+#include <vector>
+#include <stdint.h>
+#include "position.h"
+#include "transpositiontable.h"
+#include "tablebase.h"
+#include "evaluation.h"
+
+namespace Rules {
+
+struct SearchLimits {
+    int maxDepth = 64;
+    // Time budget for the whole search, 0 for none
+    int timeMs = 1000;
+    // Node budget of the main thread, 0 for none
+    uint64_t maxNodes = 0;
+    // Threads searching together. Extra threads only help through the
+    // transposition table, so they're ignored when there isn't one.
+    int threads = 1;
+};
+
+struct SearchResult {
+    Move best;
+    int score = 0;
+    int depth = 0;
+    uint64_t nodes = 0;
+    int64_t timeMs = 0;
+    // Transposition table lookups and how many found an entry
+    uint64_t ttProbes = 0;
+    uint64_t ttHits = 0;
+    // Positions answered by the endgame tablebase
+    uint64_t tbHits = 0;
+};
+
+// Iterative-deepening alpha-beta (negamax) search.
+//
+// A removal is played by the same side right after the move that earned it,
+// so the score is only negated when the side to move actually changes, and
+// removals don't use up depth.
+// Results are kept in a transposition table, if one is given, so positions
+// reached by different move orders are only searched once.
+//
+// Movement phase positions covered by the endgame tablebase, if one is set,
+// get their exact score from it instead of being searched. When the root is
+// covered, a single ply is enough to pick the best move.
+//
+// With more than one thread the search is Lazy SMP: helper threads run the
+// same iterative deepening on the same table, half of them a depth ahead,
+// and fill it with results the main thread then gets for free.
+// Moves are ordered by: the previous iteration's best line, the table's best
+// move, moves that make a mill, killer moves and then the history heuristic.
+// Next to the horizon, the children are evaluated in batches so the vector
+// kernels of the evaluation can score them several at a time.
+class Search
+{
+public:
+    static const int MAX_PLY = 128;
+    static const int WIN = 30000;
+    // Scores beyond this are wins/losses found by the search
+    static const int WIN_BOUND = WIN - MAX_PLY;
+
+    explicit Search(const Geometry &geometry, TranspositionTable *table = nullptr);
+
+    SearchResult run(const Position &root, const SearchLimits &limits);
+
+    // The tablebase has to stay open while the search runs
+    void setTablebase(const Tablebase *tablebase) { this->tablebase = tablebase; }
+    void setWeights(const EvalWeights &weights) { this->weights = weights; }
+
+    // Safe to call from another thread, the search returns its best move so far
+    void stop() { stopped.store(true, std::memory_order_relaxed); }
+
+    // Static score of a position for the side to move
+    static int evaluate(const Geometry &geometry, const Position &position, const EvalWeights &weights = EvalWeights());
+
+private:
+    // Children scored together next to the horizon
+    static const int EVAL_BATCH = 8;
+    // How often the clock is checked, in nodes
+    static const uint64_t CHECK_INTERVAL = 1024;
+
+    const Geometry &geometry;
+    TranspositionTable *table;
+    const Tablebase *tablebase = nullptr;
+    EvalWeights weights;
+    std::atomic<bool> stopped{false};
+
+    SearchLimits limits;
+    std::chrono::steady_clock::time_point startTime;
+    uint64_t nodes = 0;
+    uint64_t ttProbes = 0;
+    uint64_t ttHits = 0;
+    uint64_t tbHits = 0;
+
+    // Triangular table of the best line found at each ply
+    Move pv[MAX_PLY][MAX_PLY];
+    int pvLength[MAX_PLY];
+    Move killers[MAX_PLY][2];
+    int history[2][MAX_NODES + 1][MAX_NODES + 1];
+
+    // Children of the nodes next to the horizon and their static scores,
+    // used as a stack since those nodes can still search removals below them
+    std::vector<Position> batch;
+    std::vector<int> batchScores;
+    size_t batchTop = 0;
+
+    void prepare(const SearchLimits &limits);
+    // Iterative deepening from firstDepth, returns the deepest finished iteration
+    SearchResult iterate(const Position &root, Move fallback, int firstDepth);
+    int negamax(const Position &position, int depth, int alpha, int beta, int ply, bool followPv);
+    static int childDepthOf(const Position &position, const Position &child, int depth);
+    // Whether the child's search would stop at its static score
+    bool atHorizon(const Position &child, int depth, int ply) const;
+    void orderMoves(const Position &position, MoveList &moves, int ply, Move pvMove, Move ttMove);
+    bool outOfTime();
+    int64_t elapsedMs() const;
+};
+
+} // namespace Rules
+
+#endif // RULES_SEARCH_H
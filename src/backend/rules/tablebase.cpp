@@ -0,0 +1,168 @@
+#include "tablebase.h"
+#include <string.h>
+
+namespace Rules {
+
+const char Tablebase::MAGIC[8] = {'S', 'H', 'A', 'X', 'T', 'B', '0', '1'};
+
+namespace {
+
+struct Binomials {
+    uint64_t c[MAX_NODES + 1][MAX_NODES + 1];
+};
+
+constexpr Binomials makeBinomials(){
+    Binomials b{};
+    for (int n = 0; n <= MAX_NODES; n++) {
+        b.c[n][0] = 1;
+        for (int k = 1; k <= n; k++)
+            b.c[n][k] = b.c[n - 1][k - 1] + (k <= n - 1 ? b.c[n - 1][k] : 0);
+    }
+    return b;
+}
+
+constexpr Binomials BINOMIALS = makeBinomials();
+
+inline uint64_t choose(int n, int k){
+    return k < 0 || k > n ? 0 : BINOMIALS.c[n][k];
+}
+
+// Rank of a set of nodes among all sets of the same size, in colex order
+uint64_t rankOf(Bitboard set){
+    uint64_t rank = 0;
+    for (int i = 1; set; i++) {
+        rank += choose(popLowest(set), i);
+    }
+    return rank;
+}
+
+Bitboard unrank(uint64_t rank, int size){
+    Bitboard set = 0;
+    int node = MAX_NODES - 1;
+    for (int i = size; i > 0; i--) {
+        while (choose(node, i) > rank)
+            node--;
+        rank -= choose(node, i);
+        set |= bitOf(node);
+        node--;
+    }
+    return set;
+}
+
+} // namespace
+
+std::string Tablebase::fileName(int us, int them){
+    return std::to_string(us) + "v" + std::to_string(them) + ".shtb";
+}
+
+uint64_t Tablebase::tableSize(int nodes, int us, int them){
+    return choose(nodes, us) * choose(nodes - us, them);
+}
+
+uint64_t Tablebase::indexOf(int nodes, Bitboard us, Bitboard them){
+    // Number the nodes left free by "us" from 0 and rank "them" among those,
+    // by closing the gap each of our pieces leaves, from the top down
+    Bitboard packed = them;
+    for (Bitboard b = us; b;) {
+        int node = highestBit(b);
+        b &= ~bitOf(node);
+        Bitboard below = bitOf(node) - 1;
+        packed = (packed & below) | ((packed >> 1) & ~below);
+    }
+
+    return rankOf(us) * choose(nodes - popCount(us), popCount(them)) + rankOf(packed);
+}
+
+void Tablebase::positionAt(int nodes, int us, int them, uint64_t index, Bitboard &usPieces, Bitboard &themPieces){
+    const uint64_t perSet = choose(nodes - us, them);
+    usPieces = unrank(index / perSet, us);
+
+    // Open a gap at each of our pieces, from the bottom up
+    themPieces = unrank(index % perSet, them);
+    for (Bitboard b = usPieces; b;) {
+        Bitboard below = bitOf(popLowest(b)) - 1;
+        themPieces = (themPieces & below) | ((themPieces & ~below) << 1);
+    }
+}
+
+TablebaseResult Tablebase::decode(uint8_t value){
+    TablebaseResult result;
+    if (value > 0) {
+        result.plies = value - 1;
+        result.outcome = result.plies % 2 ? 1 : -1;
+    }
+    return result;
+}
+
+int Tablebase::open(const std::string &directory, const Geometry &geometry){
+    close();
+    nodes = geometry.nodeCount();
+    const uint64_t key = geometry.key();
+    const int most = geometry.piecesPerPlayer() < MAX_PIECES ? geometry.piecesPerPlayer() : MAX_PIECES;
+
+    for (int us = MIN_PIECES; us <= most; us++) {
+        for (int them = MIN_PIECES; them <= most && us + them <= nodes; them++) {
+            auto file = std::make_unique<MappedFile>();
+            if (!file->open(directory + "/" + fileName(us, them))) {
+                continue;
+            }
+
+            // Skip tables made for another board or cut short
+            Header header;
+            if (file->size() < sizeof(Header)) {
+                continue;
+            }
+            memcpy(&header, file->data(), sizeof(Header));
+
+            const uint64_t positions = tableSize(nodes, us, them);
+            if (memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.geometryKey != key
+                || header.nodes != nodes || header.us != us || header.them != them
+                || header.positions != positions || file->size() < sizeof(Header) + positions) {
+                continue;
+            }
+
+            tables[us][them] = std::move(file);
+            count++;
+        }
+    }
+    return count;
+}
+
+void Tablebase::close(){
+    for (auto &row : tables) {
+        for (auto &file : row) {
+            file.reset();
+        }
+    }
+    count = 0;
+}
+
+const uint8_t *Tablebase::table(int us, int them) const{
+    if (us < MIN_PIECES || them < MIN_PIECES || us > MAX_PIECES || them > MAX_PIECES || !tables[us][them]) {
+        return nullptr;
+    }
+    return tables[us][them]->data() + sizeof(Header);
+}
+
+bool Tablebase::covers(const Position &position) const{
+    return position.phase == Phase::Movement
+        && table(position.onBoard(position.side), position.onBoard(position.side ^ 1)) != nullptr;
+}
+
+bool Tablebase::probe(const Position &position, TablebaseResult &result) const{
+    if (position.phase != Phase::Movement) {
+        return false;
+    }
+
+    const Bitboard us = position.pieces[position.side];
+    const Bitboard them = position.pieces[position.side ^ 1];
+    const uint8_t *data = table(popCount(us), popCount(them));
+    if (!data) {
+        return false;
+    }
+
+    result = decode(data[indexOf(nodes, us, them)]);
+    return true;
+}
+
+} // namespace Rules
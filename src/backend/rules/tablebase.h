@@ -0,0 +1,79 @@
+#ifndef RULES_TABLEBASE_H
+#define RULES_TABLEBASE_H
+
+#include <memory>
+#include <string>
+#include <stdint.h>
+#include "position.h"
+#include "mappedfile.h"
+
+namespace Rules {
+
+struct TablebaseResult {
+    // 1 if the side to move wins, -1 if it loses, 0 for a draw
+    int outcome = 0;
+    // Moves left until the game ends with best play, 0 for draws
+    int plies = 0;
+};
+
+// Perfect-play tables for the movement phase with few pieces left,
+// as written by shax-tbgen.
+//
+// There's one file per material balance, named after the pieces of the side
+// to move and of the opponent ("4v3.shtb"). After a small header it holds
+// one byte per position:
+//   0      - draw
+//   n > 0  - the game ends n - 1 moves from here with best play, lost by the
+//            side to move if that's even and won if it's odd
+// A removal counts as part of the move that made the mill.
+//
+// Positions are indexed by the side to move's pieces, ranked among all sets
+// of that many nodes, then by the opponent's pieces ranked among the nodes
+// left free. Files are memory mapped, so opening them costs nothing and
+// probes only touch the page they need.
+class Tablebase
+{
+public:
+    // Fewest pieces a player can have and still play
+    static const int MIN_PIECES = Position::MIN_PIECES + 1;
+    static const int MAX_PIECES = MAX_NODES / 2;
+
+    struct Header {
+        char magic[8];
+        uint64_t geometryKey;
+        uint8_t nodes;
+        uint8_t us;
+        uint8_t them;
+        uint8_t reserved[5];
+        uint64_t positions;
+    };
+    static const char MAGIC[8];
+
+    // Maps every table in directory that was made for this board.
+    // Returns how many were found.
+    int open(const std::string &directory, const Geometry &geometry);
+    void close();
+    int tableCount() const { return count; }
+
+    bool covers(const Position &position) const;
+    // Answers a movement phase position, false if it isn't covered
+    bool probe(const Position &position, TablebaseResult &result) const;
+
+    // Shared with the generator
+    static std::string fileName(int us, int them);
+    static uint64_t tableSize(int nodes, int us, int them);
+    static uint64_t indexOf(int nodes, Bitboard us, Bitboard them);
+    static void positionAt(int nodes, int us, int them, uint64_t index, Bitboard &usPieces, Bitboard &themPieces);
+    static TablebaseResult decode(uint8_t value);
+
+private:
+    std::unique_ptr<MappedFile> tables[MAX_PIECES + 1][MAX_PIECES + 1];
+    int nodes = 0;
+    int count = 0;
+
+    const uint8_t *table(int us, int them) const;
+};
+
+} // namespace Rules
+
+#endif // RULES_TABLEBASE_H
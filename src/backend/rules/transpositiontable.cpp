@@ -0,0 +1,115 @@
+#include "transpositiontable.h"
+
+namespace Rules {
+
+TranspositionTable::TranspositionTable(size_t megabytes){
+    resize(megabytes);
+}
+
+void TranspositionTable::resize(size_t megabytes){
+    size_t count = 1;
+    while (count * 2 * sizeof(Bucket) <= megabytes * 1024 * 1024) {
+        count *= 2;
+    }
+
+    buckets.reset(new Bucket[count]);
+    bucketMask = count - 1;
+    clear();
+}
+
+void TranspositionTable::clear(){
+    for (size_t i = 0; i <= bucketMask; i++) {
+        for (Slot &slot : buckets[i].slots) {
+            slot.check.store(0, std::memory_order_relaxed);
+            slot.data.store(0, std::memory_order_relaxed);
+        }
+    }
+    generation = 0;
+}
+
+size_t TranspositionTable::megabytes() const{
+    return (bucketMask + 1) * sizeof(Bucket) / (1024 * 1024);
+}
+
+// Data layout: move (16 bits), score (16), depth (8), bound (2), generation (6)
+uint64_t TranspositionTable::pack(Move move, int score, int depth, Bound bound, uint8_t generation){
+    return (uint64_t)move.raw()
+         | (uint64_t)(uint16_t)(int16_t)score << 16
+         | (uint64_t)(uint8_t)(int8_t)depth << 32
+         | (uint64_t)bound << 40
+         | (uint64_t)(generation & GENERATION_MASK) << 42;
+}
+
+TTEntry TranspositionTable::unpack(uint64_t data){
+    TTEntry entry;
+    entry.move = Move::fromRaw((uint16_t)data);
+    entry.score = (int16_t)(uint16_t)(data >> 16);
+    entry.depth = depthOf(data);
+    entry.bound = (Bound)((data >> 40) & 0x3);
+    return entry;
+}
+
+bool TranspositionTable::probe(uint64_t key, TTEntry &entry) const{
+    const Bucket &bucket = buckets[key & bucketMask];
+
+    for (const Slot &slot : bucket.slots) {
+        uint64_t data = slot.data.load(std::memory_order_relaxed);
+        if ((slot.check.load(std::memory_order_relaxed) ^ data) != key) {
+            continue;
+        }
+
+        entry = unpack(data);
+        return entry.bound != Bound::None;
+    }
+    return false;
+}
+
+void TranspositionTable::store(uint64_t key, Move move, int score, int depth, Bound bound){
+    Bucket &bucket = buckets[key & bucketMask];
+    Slot *target = &bucket.slots[0];
+    int worst = INT32_MAX;
+
+    for (Slot &slot : bucket.slots) {
+        uint64_t data = slot.data.load(std::memory_order_relaxed);
+
+        if ((slot.check.load(std::memory_order_relaxed) ^ data) == key) {
+            // Keep a deeper result from this search unless the new one is exact
+            if (generationOf(data) == generation && depthOf(data) > depth && bound != Bound::Exact) {
+                return;
+            }
+            // Don't lose the best move to a result that has none
+            if (move == Move()) {
+                move = unpack(data).move;
+            }
+            target = &slot;
+            break;
+        }
+
+        int age = (generation - generationOf(data)) & GENERATION_MASK;
+        int value = depthOf(data) - 8 * age;
+        if (value < worst) {
+            worst = value;
+            target = &slot;
+        }
+    }
+
+    uint64_t data = pack(move, score, depth, bound, generation);
+    target->check.store(key ^ data, std::memory_order_relaxed);
+    target->data.store(data, std::memory_order_relaxed);
+}
+
+int TranspositionTable::usage() const{
+    const size_t sample = bucketMask + 1 < 1000 ? bucketMask + 1 : 1000;
+    int used = 0;
+
+    for (size_t i = 0; i < sample; i++) {
+        for (const Slot &slot : buckets[i].slots) {
+            uint64_t data = slot.data.load(std::memory_order_relaxed);
+            if (data != 0 && generationOf(data) == generation)
+                used++;
+        }
+    }
+    return (int)(used * 1000 / (sample * BUCKET_SIZE));
+}
+
+} // namespace Rules
@@ -0,0 +1,81 @@
+#ifndef RULES_TRANSPOSITIONTABLE_H
+#define RULES_TRANSPOSITIONTABLE_H
+
+#include <atomic>
+#include <memory>
+#include <stddef.h>
+#include <stdint.h>
+#include "position.h"
+
+namespace Rules {
+
+// How a stored score relates to the position's real score
+enum class Bound : uint8_t {
+    None,
+    Upper,
+    Lower,
+    Exact
+};
+
+struct TTEntry {
+    Move move;
+    int score = 0;
+    int depth = 0;
+    Bound bound = Bound::None;
+};
+
+// Fixed-size table of search results, keyed by Position::key.
+//
+// Buckets of BUCKET_SIZE entries fill one cache line. A new result replaces
+// the entry with the same key, or else the bucket's least useful entry:
+// the shallowest one, with entries left over from older searches counting
+// as shallower the older they are.
+//
+// The table is shared between threads without locks. Each entry is stored as
+// two words, key ^ data and data, so an entry torn by two threads writing it
+// at once fails the key check and reads as a miss instead of a wrong result.
+class TranspositionTable
+{
+public:
+    static const int BUCKET_SIZE = 4;
+
+    explicit TranspositionTable(size_t megabytes = 16);
+
+    // Drops everything, the size is rounded down to a power of two buckets
+    void resize(size_t megabytes);
+    void clear();
+    size_t megabytes() const;
+
+    // Called at the start of every search so older results get replaced first
+    void newSearch() { generation = (uint8_t)((generation + 1) & GENERATION_MASK); }
+
+    bool probe(uint64_t key, TTEntry &entry) const;
+    void store(uint64_t key, Move move, int score, int depth, Bound bound);
+
+    // Entries written by the current search, per mille, estimated from a sample
+    int usage() const;
+
+private:
+    static const uint8_t GENERATION_MASK = 0x3f;
+
+    struct Slot {
+        std::atomic<uint64_t> check;
+        std::atomic<uint64_t> data;
+    };
+    struct alignas(64) Bucket {
+        Slot slots[BUCKET_SIZE];
+    };
+
+    std::unique_ptr<Bucket[]> buckets;
+    size_t bucketMask = 0;
+    uint8_t generation = 0;
+
+    static uint64_t pack(Move move, int score, int depth, Bound bound, uint8_t generation);
+    static TTEntry unpack(uint64_t data);
+    static uint8_t generationOf(uint64_t data) { return (uint8_t)((data >> 42) & GENERATION_MASK); }
+    static int depthOf(uint64_t data) { return (int)(int8_t)(data >> 32); }
+};
+
+} // namespace Rules
+
+#endif // RULES_TRANSPOSITIONTABLE_H
@@ -0,0 +1,58 @@
+#ifndef RULES_ZOBRIST_H
+#define RULES_ZOBRIST_H
+
+#include <stdint.h>
+#include "bitboard.h"
+
+namespace Rules {
+
+// Random keys for every part of a position.
+// A position's key is the XOR of the keys of its parts, so a move only has
+// to XOR in and out the parts it changes. The keys are generated at compile
+// time from a fixed seed, so they're the same in every build and can be
+// saved to files.
+struct ZobristKeys {
+    uint64_t pieces[2][MAX_NODES];
+    uint64_t inHand[2][MAX_NODES + 1];
+    // By phase, with the side to move folded in
+    uint64_t state[5][2];
+    // By player that made the first mill, plus one for nobody
+    uint64_t firstJare[3];
+};
+
+namespace detail {
+
+constexpr uint64_t splitMix64(uint64_t &seed){
+    uint64_t z = (seed += 0x9e3779b97f4a7c15ull);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+}
+
+constexpr ZobristKeys generateZobristKeys(){
+    ZobristKeys keys{};
+    uint64_t seed = 0x5348415852554c45ull;
+
+    for (int player = 0; player < 2; player++) {
+        for (int node = 0; node < MAX_NODES; node++)
+            keys.pieces[player][node] = splitMix64(seed);
+        for (int count = 0; count <= MAX_NODES; count++)
+            keys.inHand[player][count] = splitMix64(seed);
+    }
+    for (int phase = 0; phase < 5; phase++) {
+        keys.state[phase][0] = splitMix64(seed);
+        keys.state[phase][1] = splitMix64(seed);
+    }
+    for (int i = 0; i < 3; i++) {
+        keys.firstJare[i] = splitMix64(seed);
+    }
+    return keys;
+}
+
+} // namespace detail
+
+inline constexpr ZobristKeys ZOBRIST = detail::generateZobristKeys();
+
+} // namespace Rules
+
+#endif // RULES_ZOBRIST_H
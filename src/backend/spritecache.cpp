@@ -0,0 +1,103 @@
+#include "spritecache.h"
+#include <QCoreApplication>
+#include <QPaintDevice>
+#include <QtMath>
+
+bool SpriteCache::enabled = true;
+QHash<SpriteCache::Key, QPixmap> SpriteCache::sprites;
+
+bool SpriteCache::Circle::operator==(const Circle &other) const{
+    return fill == other.fill && outline == other.outline && outlineWidth == other.outlineWidth
+        && radius == other.radius && sheen == other.sheen;
+}
+
+bool SpriteCache::Key::operator==(const Key &other) const{
+    return circle == other.circle && pixelRatio == other.pixelRatio;
+}
+
+size_t qHash(const SpriteCache::Key &key, size_t seed){
+    const SpriteCache::Circle &circle = key.circle;
+    return qHashMulti(seed, circle.fill.rgba(), circle.outline.rgba(), circle.outlineWidth,
+                      circle.radius, circle.sheen, key.pixelRatio);
+}
+
+
+// ********************************** DRAWING *********************************** //
+void SpriteCache::draw(QPainter *painter, const Circle &circle){
+    if (!enabled || painter->worldTransform().type() > QTransform::TxTranslate) {
+        render(painter, circle);
+        return;
+    }
+
+    const qreal pixelRatio = painter->device()->devicePixelRatio();
+    const Key key = {circle, pixelRatio};
+
+    auto sprite = sprites.constFind(key);
+    if (sprite == sprites.constEnd()) {
+        // Pixmaps can't outlive the application
+        static bool clearedOnExit = false;
+        if (!clearedOnExit) {
+            qAddPostRoutine(clear);
+            clearedOnExit = true;
+        }
+        sprite = sprites.insert(key, createSprite(circle, pixelRatio));
+    }
+
+    // Sprites are square with the circle in the middle
+    const qreal half = sprite->width() / pixelRatio / 2;
+    painter->drawPixmap(QPointF(-half, -half), *sprite);
+}
+
+void SpriteCache::render(QPainter *painter, const Circle &circle){
+    QRectF rect(-circle.radius, -circle.radius, circle.radius * 2, circle.radius * 2);
+
+    painter->setPen(QPen(circle.outline, circle.outlineWidth));
+    painter->setBrush(QBrush(circle.fill));
+    painter->drawEllipse(rect);
+
+    if (circle.sheen > 0) {
+        QRectF highlightRect = QRectF(0, 0, rect.width() * circle.sheen, rect.height() * circle.sheen);
+        highlightRect.moveCenter(rect.center());
+
+        QColor highlightColor = circle.fill.lighter(150);
+        painter->setPen(QPen(highlightColor, 2));
+        painter->setBrush(QBrush(highlightColor));
+        painter->drawArc(highlightRect, 120*16, 120*16);
+    }
+}
+
+QPixmap SpriteCache::createSprite(const Circle &circle, qreal pixelRatio){
+    // Room for the outline, half of which is outside the circle, and for the
+    // antialiasing around it
+    const qreal extent = circle.radius + circle.outlineWidth / 2 + 1;
+    const int pixels = qCeil(extent * 2 * pixelRatio);
+
+    QPixmap sprite(pixels, pixels);
+    sprite.setDevicePixelRatio(pixelRatio);
+    sprite.fill(Qt::transparent);
+
+    QPainter painter(&sprite);
+    painter.setRenderHint(QPainter::Antialiasing);
+    painter.translate(pixels / pixelRatio / 2, pixels / pixelRatio / 2);
+    render(&painter, circle);
+
+    return sprite;
+}
+
+
+// ********************************** SETTINGS *********************************** //
+void SpriteCache::setEnabled(bool enabled){
+    SpriteCache::enabled = enabled;
+}
+
+bool SpriteCache::isEnabled(){
+    return enabled;
+}
+
+void SpriteCache::clear(){
+    sprites.clear();
+}
+
+int SpriteCache::size(){
+    return sprites.size();
+}
@@ -0,0 +1,58 @@
+#ifndef SPRITECACHE_H
+#define SPRITECACHE_H
+
+#include <QColor>
+#include <QHash>
+#include <QPainter>
+#include <QPixmap>
+
+// Pre-rendered images of the round items on the board (pieces and nodes).
+// Antialiasing a circle and its outline costs much more than copying a
+// pixmap, and a board only ever shows a few different ones, so each is drawn
+// once per size and device pixel ratio and blitted after that.
+// Only used from the GUI thread.
+class SpriteCache
+{
+public:
+    struct Circle {
+        QColor fill;
+        QColor outline;
+        float outlineWidth = 1;
+        float radius = 0;
+        // Size of the lighter arc on the top left, relative to the circle,
+        // 0 for none
+        float sheen = 0;
+
+        bool operator==(const Circle &other) const;
+    };
+
+    // Draws the circle centered on the painter's origin. Items that are
+    // scaled or rotated at the moment (animations) would blur a pixmap, so
+    // they're drawn directly instead.
+    static void draw(QPainter *painter, const Circle &circle);
+    // Draws it directly, it's also how the sprites are made
+    static void render(QPainter *painter, const Circle &circle);
+
+    // Turning the cache off draws everything directly, to compare the two.
+    // The board's own pixmap follows it too.
+    static void setEnabled(bool enabled);
+    static bool isEnabled();
+    static void clear();
+    static int size();
+
+private:
+    struct Key {
+        Circle circle;
+        qreal pixelRatio;
+
+        bool operator==(const Key &other) const;
+    };
+    friend size_t qHash(const Key &key, size_t seed);
+
+    static QPixmap createSprite(const Circle &circle, qreal pixelRatio);
+
+    static bool enabled;
+    static QHash<Key, QPixmap> sprites;
+};
+
+#endif // SPRITECACHE_H
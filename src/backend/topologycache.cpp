@@ -0,0 +1,100 @@
+#include "topologycache.h"
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QStandardPaths>
+#include <QSaveFile>
+#include <QFile>
+#include <QDir>
+#include <QDebug>
+#include <algorithm>
+
+static const quint32 CACHE_MAGIC = 0x53485450; // "SHTP"
+static const quint32 CACHE_VERSION = 1;
+
+TopologyCache::TopologyCache()
+{
+    cacheDir = QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation) + "/topologies";
+}
+
+QString TopologyCache::filePath(const QString &hash) const{
+    return cacheDir + "/" + hash + ".bin";
+}
+
+QString TopologyCache::hashOf(const BoardTopology &topology){
+    auto lessThan = [](const QPoint &a, const QPoint &b) {
+        return a.y() != b.y() ? a.y() < b.y() : a.x() < b.x();
+    };
+
+    QList<QPoint> nodes = topology.keys();
+    std::sort(nodes.begin(), nodes.end(), lessThan);
+
+    QByteArray bytes;
+    QDataStream stream(&bytes, QIODevice::WriteOnly);
+    stream.setByteOrder(QDataStream::BigEndian);
+
+    for (const QPoint &node : nodes) {
+        QList<QPoint> neighbors = topology.value(node);
+        std::sort(neighbors.begin(), neighbors.end(), lessThan);
+
+        stream << (qint32)node.x() << (qint32)node.y() << (qint32)neighbors.size();
+        for (const QPoint &neighbor : neighbors) {
+            stream << (qint32)neighbor.x() << (qint32)neighbor.y();
+        }
+    }
+
+    return QCryptographicHash::hash(bytes, QCryptographicHash::Sha256).toHex();
+}
+
+bool TopologyCache::lookup(const QString &hash, BoardTopology &topology){
+    // Check the topologies that were already loaded this session
+    if (auto it = loaded.constFind(hash); it != loaded.constEnd()) {
+        topology = it.value();
+        return true;
+    }
+
+    QFile file(filePath(hash));
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    QDataStream stream(&file);
+    quint32 magic = 0, version = 0;
+    BoardTopology cached;
+    stream >> magic >> version;
+    if (magic != CACHE_MAGIC || version != CACHE_VERSION) {
+        qDebug() << "Ignoring an incompatible topology cache file:" << file.fileName();
+        return false;
+    }
+    stream >> cached;
+
+    // Drop the entry if it doesn't match its own key
+    if (stream.status() != QDataStream::Ok || hashOf(cached) != hash) {
+        qDebug() << "Removing a corrupted topology cache file:" << file.fileName();
+        file.close();
+        file.remove();
+        return false;
+    }
+
+    loaded.insert(hash, cached);
+    topology = cached;
+    return true;
+}
+
+void TopologyCache::store(const QString &hash, const BoardTopology &topology){
+    loaded.insert(hash, topology);
+
+    if (QFile::exists(filePath(hash)) || !QDir().mkpath(cacheDir)) {
+        return;
+    }
+
+    // Write the whole file or nothing so a half-written entry is never read
+    QSaveFile file(filePath(hash));
+    if (!file.open(QIODevice::WriteOnly)) {
+        qDebug() << "Couldn't write to the topology cache:" << file.fileName();
+        return;
+    }
+
+    QDataStream stream(&file);
+    stream << CACHE_MAGIC << CACHE_VERSION << topology;
+    file.commit();
+}
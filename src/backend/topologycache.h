@@ -0,0 +1,31 @@
+#ifndef TOPOLOGYCACHE_H
+#define TOPOLOGYCACHE_H
+
+#include <QString>
+#include <QHash>
+#include "protocol.h"
+
+// Persistent cache of board topologies keyed by the hash of their contents.
+// Lets the client tell the server which board it already has so the server
+// can leave the adjacent_pieces graph out of its join_game response.
+class TopologyCache
+{
+public:
+    TopologyCache();
+
+    // SHA-256 (hex) of a topology in its canonical form:
+    // the nodes sorted by (y, x), each written as x, y, neighbor count and then
+    // its neighbors sorted by (y, x), with every number as a big-endian int32.
+    static QString hashOf(const BoardTopology &topology);
+
+    bool lookup(const QString &hash, BoardTopology &topology);
+    void store(const QString &hash, const BoardTopology &topology);
+
+private:
+    QString cacheDir;
+    QHash<QString, BoardTopology> loaded;
+
+    QString filePath(const QString &hash) const;
+};
+
+#endif // TOPOLOGYCACHE_H
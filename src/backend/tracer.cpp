@@ -0,0 +1,158 @@
+#include "tracer.h"
+#include <QCoreApplication>
+#include <QThread>
+#include <QFile>
+#include <QJsonValue>
+#include <QJsonDocument>
+#include <QJsonArray>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+std::atomic<bool> Tracer::enabled{false};
+
+// A thread's events in a ring buffer. Only the thread itself writes to it,
+// so the lock is only ever contended while a trace is being exported.
+// It grows as events come in and wraps once it holds EVENTS_PER_THREAD.
+struct Tracer::ThreadBuffer {
+    std::mutex mutex;
+    std::vector<Event> events;
+    size_t next = 0;
+    uint64_t written = 0;
+
+    int tid;
+    QString name;
+};
+
+namespace {
+
+// Buffers outlive their threads, the events are still wanted after they exit
+std::mutex registryMutex;
+std::vector<std::unique_ptr<Tracer::ThreadBuffer>> &registry(){
+    static std::vector<std::unique_ptr<Tracer::ThreadBuffer>> buffers;
+    return buffers;
+}
+
+QByteArray quoted(const QString &text){
+    // The simplest way to escape a string for JSON
+    QByteArray json = QJsonDocument(QJsonArray{text}).toJson(QJsonDocument::Compact);
+    return json.mid(1, json.size() - 2);
+}
+
+} // namespace
+
+int64_t Tracer::now(){
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void Tracer::setEnabled(bool enabled){
+    Tracer::enabled.store(enabled, std::memory_order_relaxed);
+}
+
+Tracer::ThreadBuffer *Tracer::localBuffer(){
+    thread_local ThreadBuffer *buffer = nullptr;
+    if (buffer) {
+        return buffer;
+    }
+
+    auto created = std::make_unique<ThreadBuffer>();
+
+    QThread *thread = QThread::currentThread();
+    if (QCoreApplication::instance() && thread == QCoreApplication::instance()->thread())
+        created->name = "GUI";
+    else
+        created->name = thread->objectName();
+
+    std::lock_guard<std::mutex> lock(registryMutex);
+    created->tid = registry().size() + 1;
+    if (created->name.isEmpty())
+        created->name = QString("Thread %1").arg(created->tid);
+
+    buffer = created.get();
+    registry().push_back(std::move(created));
+    return buffer;
+}
+
+void Tracer::record(const char *name, const char *category, int64_t start, int64_t duration, const QString &detail){
+    ThreadBuffer *buffer = localBuffer();
+
+    std::lock_guard<std::mutex> lock(buffer->mutex);
+    const Event event = {name, category, start, duration, detail};
+    if (buffer->events.size() < EVENTS_PER_THREAD)
+        buffer->events.push_back(event);
+    else
+        buffer->events[buffer->next] = event;
+
+    buffer->next = (buffer->next + 1) % EVENTS_PER_THREAD;
+    buffer->written++;
+}
+
+void Tracer::clear(){
+    std::lock_guard<std::mutex> lock(registryMutex);
+    for (auto &buffer : registry()) {
+        std::lock_guard<std::mutex> bufferLock(buffer->mutex);
+        // Hands the memory back, a buffer that's full holds a few MB
+        std::vector<Event>().swap(buffer->events);
+        buffer->next = 0;
+        buffer->written = 0;
+    }
+}
+
+
+// ********************************** EXPORT *********************************** //
+int Tracer::dump(const QString &fileName){
+    const QByteArray pid = QByteArray::number(QCoreApplication::applicationPid());
+    QByteArray json;
+    json += "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    json += "{\"ph\":\"M\",\"name\":\"process_name\",\"pid\":" + pid + ",\"tid\":0,\"args\":{\"name\":"
+            + quoted(QCoreApplication::applicationName()) + "}}";
+
+    int count = 0;
+    std::unique_lock<std::mutex> lock(registryMutex);
+    for (auto &buffer : registry()) {
+        // Copied out so the thread isn't held up while the JSON is built
+        std::vector<Event> events;
+        {
+            std::lock_guard<std::mutex> bufferLock(buffer->mutex);
+            const size_t kept = qMin<uint64_t>(buffer->written, EVENTS_PER_THREAD);
+            events.reserve(kept);
+            for (size_t i = 0; i < kept; i++) {
+                events.push_back(buffer->events[(buffer->next + EVENTS_PER_THREAD - kept + i) % EVENTS_PER_THREAD]);
+            }
+        }
+
+        const QByteArray tid = QByteArray::number(buffer->tid);
+        json += ",\n{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":" + pid + ",\"tid\":" + tid
+                + ",\"args\":{\"name\":" + quoted(buffer->name) + "}}";
+
+        // Timestamps are in us
+        for (const Event &event : events) {
+            json += ",\n{\"ph\":\"X\",\"name\":\"";
+            json += event.name;
+            json += "\",\"cat\":\"";
+            json += event.category;
+            json += "\",\"pid\":" + pid + ",\"tid\":" + tid;
+            json += ",\"ts\":" + QByteArray::number(event.start / 1000.0, 'f', 3);
+            json += ",\"dur\":" + QByteArray::number(event.duration / 1000.0, 'f', 3);
+            if (!event.detail.isEmpty()) {
+                json += ",\"args\":{\"detail\":" + quoted(event.detail) + "}";
+            }
+            json += "}";
+        }
+        count += events.size();
+    }
+    lock.unlock();
+    json += "\n]}\n";
+
+    if (count == 0) {
+        return 0;
+    }
+
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        return -1;
+    }
+    file.write(json);
+    return count;
+}
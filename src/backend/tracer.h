@@ -0,0 +1,82 @@
+#ifndef TRACER_H
+#define TRACER_H
+
+#include <QString>
+#include <atomic>
+#include <stdint.h>
+
+// Timeline of what the client is doing, in the Chrome trace event format
+// that Perfetto and chrome://tracing open.
+// Code is wrapped in a Scope, which records when it started and how long it
+// took. Each thread appends to a buffer of its own, only the export has to
+// wait on it. A buffer keeps the latest EVENTS_PER_THREAD events, at about
+// 56 bytes each plus their detail that's up to 3.7 MB per thread. It's held
+// until clear().
+// Switched off, a Scope costs a relaxed load and a branch.
+class Tracer
+{
+public:
+    // name and category aren't copied, they have to be literals
+    class Scope
+    {
+    public:
+        Scope(const char *name, const char *category)
+            : name(name), category(category), start(isEnabled() ? now() : -1) {}
+        ~Scope() {
+            if (start >= 0)
+                record(name, category, start, now() - start, detail);
+        }
+
+        // Shown with the event, e.g. which request it was. The argument is
+        // built even when tracing is off, guard costly ones with isEnabled().
+        void setDetail(const QString &detail) {
+            if (start >= 0)
+                this->detail = detail;
+        }
+
+        Scope(const Scope &) = delete;
+        Scope &operator=(const Scope &) = delete;
+
+    private:
+        const char *name;
+        const char *category;
+        int64_t start;
+        QString detail;
+    };
+
+    static void setEnabled(bool enabled);
+    static bool isEnabled() { return enabled.load(std::memory_order_relaxed); }
+
+    // Monotonic timestamp in ns, comparable across threads
+    static int64_t now();
+
+    // For spans that don't fit in a scope, like animations
+    static void record(const char *name, const char *category, int64_t start, int64_t duration,
+                       const QString &detail = QString());
+
+    // Writes every thread's events as trace event JSON, nothing if there
+    // are none. Returns the number of events written, -1 if the file can't
+    // be opened.
+    static int dump(const QString &fileName);
+    static void clear();
+
+    // Defined in tracer.cpp
+    struct ThreadBuffer;
+
+private:
+    static const int EVENTS_PER_THREAD = 1 << 16;
+
+    struct Event {
+        const char *name;
+        const char *category;
+        int64_t start;
+        int64_t duration;
+        QString detail;
+    };
+
+    static std::atomic<bool> enabled;
+
+    static ThreadBuffer *localBuffer();
+};
+
+#endif // TRACER_H
@@ -0,0 +1,75 @@
+#include "framemonitor.h"
+#include <QDebug>
+
+FrameMonitor::FrameMonitor(QObject *parent)
+    : QObject{parent}
+{
+    frameTimer.setTimerType(Qt::PreciseTimer);
+    frameTimer.setInterval(FRAME_INTERVAL);
+    QObject::connect(&frameTimer, &QTimer::timeout, this, &FrameMonitor::onFrame);
+}
+
+void FrameMonitor::setEnabled(bool enabled){
+    if (enabled == frameTimer.isActive()) {
+        return;
+    }
+
+    if (enabled) {
+        reset();
+        frameClock.start();
+        reportClock.start();
+        frameTimer.start();
+    }
+    else {
+        frameTimer.stop();
+    }
+}
+
+bool FrameMonitor::isEnabled() const{
+    return frameTimer.isActive();
+}
+
+void FrameMonitor::protocolEvent(){
+    protocolEvents++;
+}
+
+void FrameMonitor::onFrame(){
+    int64_t now = frameClock.nsecsElapsed();
+    int64_t interval = now - lastFrame;
+    lastFrame = now;
+
+    totalInterval += interval;
+    maxInterval = qMax(maxInterval, interval);
+    frames++;
+
+    // A frame is late once the loop missed a whole tick
+    if (interval > 2 * FRAME_INTERVAL * 1000000LL) {
+        lateFrames++;
+    }
+
+    if (reportClock.elapsed() >= REPORT_INTERVAL) {
+        report();
+        reset();
+        reportClock.restart();
+    }
+}
+
+void FrameMonitor::report(){
+    if (frames == 0) {
+        return;
+    }
+
+    qDebug().nospace() << "Frame times: avg " << totalInterval / frames / 1000 << "us"
+                       << ", max " << maxInterval / 1000 << "us"
+                       << ", late " << lateFrames << "/" << frames
+                       << ", protocol events " << protocolEvents;
+}
+
+void FrameMonitor::reset(){
+    lastFrame = frameClock.isValid() ? frameClock.nsecsElapsed() : 0;
+    totalInterval = 0;
+    maxInterval = 0;
+    frames = 0;
+    lateFrames = 0;
+    protocolEvents = 0;
+}
@@ -0,0 +1,46 @@
+#ifndef FRAMEMONITOR_H
+#define FRAMEMONITOR_H
+
+#include <QObject>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <stdint.h>
+
+// Measures how regularly the GUI thread gets to run.
+// A precise timer is scheduled every frame, the gap between its ticks shows
+// how long the event loop was blocked (by message handling, painting, ...).
+class FrameMonitor : public QObject
+{
+    Q_OBJECT
+public:
+    explicit FrameMonitor(QObject *parent = nullptr);
+
+    void setEnabled(bool enabled);
+    bool isEnabled() const;
+
+public slots:
+    // Counts protocol messages handled since the last report
+    void protocolEvent();
+
+private:
+    const int FRAME_INTERVAL = 16;
+    const int REPORT_INTERVAL = 5000;
+
+    QTimer frameTimer;
+    QElapsedTimer frameClock;
+    QElapsedTimer reportClock;
+
+    // Stats since the last report, in ns
+    int64_t lastFrame = 0;
+    int64_t totalInterval = 0;
+    int64_t maxInterval = 0;
+    uint32_t frames = 0;
+    uint32_t lateFrames = 0;
+    uint32_t protocolEvents = 0;
+
+    void onFrame();
+    void report();
+    void reset();
+};
+
+#endif // FRAMEMONITOR_H
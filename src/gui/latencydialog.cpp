@@ -0,0 +1,69 @@
+#include "latencydialog.h"
+#include <QVBoxLayout>
+#include <QHBoxLayout>
+#include <QHeaderView>
+#include <QPushButton>
+
+LatencyDialog::LatencyDialog(LatencyStats *latency, QWidget *parent)
+    : QDialog{parent}
+{
+    this->latency = latency;
+
+    setWindowTitle(tr("Latency"));
+
+    table = new QTableWidget(0, 6, this);
+    table->setHorizontalHeaderLabels({tr("Series"), tr("Count"), tr("p50 (ms)"), tr("p95 (ms)"), tr("p99 (ms)"), tr("Max (ms)")});
+    table->horizontalHeader()->setSectionResizeMode(QHeaderView::ResizeToContents);
+    table->verticalHeader()->hide();
+    table->setEditTriggers(QAbstractItemView::NoEditTriggers);
+
+    QPushButton *resetBtn = new QPushButton(tr("Reset"), this);
+    QObject::connect(resetBtn, &QPushButton::clicked, this, [this]{
+        this->latency->clear();
+        refresh();
+    });
+
+    QHBoxLayout *buttons = new QHBoxLayout;
+    buttons->addStretch();
+    buttons->addWidget(resetBtn);
+
+    QVBoxLayout *layout = new QVBoxLayout(this);
+    layout->addWidget(table);
+    layout->addLayout(buttons);
+
+    resize(560, 320);
+
+    // Only refresh while the panel is visible
+    refreshTimer.setInterval(REFRESH_INTERVAL);
+    QObject::connect(&refreshTimer, &QTimer::timeout, this, &LatencyDialog::refresh);
+}
+
+void LatencyDialog::showEvent(QShowEvent *event){
+    refresh();
+    refreshTimer.start();
+    QDialog::showEvent(event);
+}
+
+void LatencyDialog::hideEvent(QHideEvent *event){
+    refreshTimer.stop();
+    QDialog::hideEvent(event);
+}
+
+void LatencyDialog::refresh(){
+    const QList<LatencySummary> rows = latency->summaries();
+    table->setRowCount(rows.size());
+
+    auto ms = [](int64_t us){
+        return new QTableWidgetItem(QString::number(us / 1000.0, 'f', 2));
+    };
+
+    for (int i = 0; i < rows.size(); i++) {
+        const LatencySummary &row = rows[i];
+        table->setItem(i, 0, new QTableWidgetItem(row.name));
+        table->setItem(i, 1, new QTableWidgetItem(QString::number(row.count)));
+        table->setItem(i, 2, ms(row.p50));
+        table->setItem(i, 3, ms(row.p95));
+        table->setItem(i, 4, ms(row.p99));
+        table->setItem(i, 5, ms(row.max));
+    }
+}
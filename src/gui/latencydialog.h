@@ -0,0 +1,30 @@
+#ifndef LATENCYDIALOG_H
+#define LATENCYDIALOG_H
+
+#include <QDialog>
+#include <QTableWidget>
+#include <QTimer>
+#include "../backend/latencystats.h"
+
+// Debug panel with the latency histograms of the current session
+class LatencyDialog : public QDialog
+{
+    Q_OBJECT
+public:
+    explicit LatencyDialog(LatencyStats *latency, QWidget *parent = nullptr);
+
+protected:
+    void showEvent(QShowEvent *event) override;
+    void hideEvent(QHideEvent *event) override;
+
+private:
+    const int REFRESH_INTERVAL = 1000;
+
+    LatencyStats *latency;
+    QTableWidget *table;
+    QTimer refreshTimer;
+
+    void refresh();
+};
+
+#endif // LATENCYDIALOG_H
@@ -1,6 +1,5 @@
 #include "mainwindow.h"
 #include "./ui_mainwindow.h"
-#include "../backend/node.h"
 
 #include <QCloseEvent>
 #include <QMessageBox>
@@ -11,6 +10,11 @@
 #include <QDir>
 #include <QPropertyAnimation>
 #include <QGraphicsOpacityEffect>
+#include <QSet>
+#include <QShortcut>
+#include "../backend/animationscheduler.h"
+#include "../backend/renderprofiler.h"
+#include "../backend/tracer.h"
 
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent)
@@ -30,19 +34,38 @@ MainWindow::MainWindow(QWidget *parent)
 
     // Add a blank scene to the graphics view
     scene = new QGraphicsScene();
+    // The scene only holds the board and the pieces, most of which are
+    // moving, so keeping an index of them costs more than it saves
+    scene->setItemIndexMethod(QGraphicsScene::NoIndex);
     ui->graphicsView->setScene(scene);
 
     // Init boardManager
     boardManager = new BoardManager(&settings);
 
+    // Logs how long the GUI thread is blocked, for profiling
+    frameMonitor.setEnabled(settings.value("debug/frame_monitor", false).toBool());
+    AnimationScheduler::instance()->setReporting(frameMonitor.isEnabled());
+
+    // Frame times and where they go, drawn over the board
+    profilerOverlay = new ProfilerOverlay(ui->graphicsView);
+    profilerOverlay->setActive(settings.value("debug/render_profiler", false).toBool());
+
+    // Timeline of requests, handlers and paints for Perfetto
+    Tracer::setEnabled(settings.value("debug/trace", false).toBool());
+
     connectAll();
 }
 
 MainWindow::~MainWindow()
 {
+    exportRenderProfile();
+
     delete ui;
     delete boardManager;
     delete scene;
+
+    // After the worker thread has finished, so its events are all in
+    exportTrace();
 }
 
 
@@ -61,7 +84,20 @@ void MainWindow::connectAll(){
     QObject::connect(ui->settingsBtn, &QPushButton::clicked, this, &MainWindow::settingsButtonClicked);
     QObject::connect(ui->saveSettingsBtn, &QPushButton::clicked, this, &MainWindow::saveSettingsButtonClicked);
 
+    // Debug panels
+    QShortcut *latencyShortcut = new QShortcut(QKeySequence(tr("Ctrl+Shift+L")), this);
+    QObject::connect(latencyShortcut, &QShortcut::activated, this, &MainWindow::showLatencyDialog);
+    QShortcut *profilerShortcut = new QShortcut(QKeySequence(tr("Ctrl+Shift+P")), this);
+    QObject::connect(profilerShortcut, &QShortcut::activated, this, [this]{
+        profilerOverlay->setActive(!RenderProfiler::isEnabled());
+    });
+    QShortcut *exportShortcut = new QShortcut(QKeySequence(tr("Ctrl+Shift+E")), this);
+    QObject::connect(exportShortcut, &QShortcut::activated, this, &MainWindow::exportRenderProfile);
+    QShortcut *traceShortcut = new QShortcut(QKeySequence(tr("Ctrl+Shift+T")), this);
+    QObject::connect(traceShortcut, &QShortcut::activated, this, &MainWindow::toggleTrace);
+
     // Connect signals from the board manager
+    QObject::connect(boardManager, &BoardManager::protocolEventReceived, &frameMonitor, &FrameMonitor::protocolEvent);
     QObject::connect(boardManager, &BoardManager::connected, this, &MainWindow::connectedToBoard);
     QObject::connect(boardManager, &BoardManager::connectionError, this, &MainWindow::connectionErrorHandler);
     QObject::connect(boardManager, &BoardManager::startGameResponded, this, &MainWindow::startGameResponseHandler);
@@ -69,49 +105,78 @@ void MainWindow::connectAll(){
     QObject::connect(boardManager, &BoardManager::removePieceResponded, this, &MainWindow::removePieceResponseHandler);
     QObject::connect(boardManager, &BoardManager::movePieceResponded, this, &MainWindow::movePieceResponseHandler);
     QObject::connect(boardManager, &BoardManager::quitGameResponded, this, &MainWindow::quitGameResponseHandler);
+    QObject::connect(boardManager, &BoardManager::activePiecesSynced, this, &MainWindow::activePiecesSyncedHandler);
+    QObject::connect(boardManager, &BoardManager::connectionInterrupted, this, &MainWindow::connectionInterruptedHandler);
+    QObject::connect(boardManager, &BoardManager::gameResumed, this, &MainWindow::gameResumedHandler);
+    QObject::connect(boardManager, &BoardManager::movePredicted, this, &MainWindow::movePredictedHandler);
+    QObject::connect(boardManager, &BoardManager::predictionConfirmed, this, &MainWindow::predictionConfirmedHandler);
+    QObject::connect(boardManager, &BoardManager::predictionRolledBack, this, &MainWindow::predictionRolledBackHandler);
 }
 
-void MainWindow::initBoard(QHash<QPoint, QList<QPoint>> adjacentPieces){
+void MainWindow::initBoard(BoardTopology adjacentPieces, QString topologyHash){
+    Tracer::Scope trace("MainWindow::initBoard", "gui");
+
     playerColors[0] = p1_color;
     playerColors[1] = p2_color;
 
+    hideLoading();
+    clearGamePieces();
+
+    // Reuse the drawn board if the layout hasn't changed since the last game
+    if (!topologyHash.isEmpty() && topologyHash == boardHash && board) {
+        board->show();
+
+        qDebug() << "Reused the previous board.\n";
+        return;
+    }
+
     QPen linesPen(linesColor, penWidth);
     QPen nodesPen(linesColor, nodesBorderThickness);
 
     // Clears all items from the scene
     scene->clear();
+    boardHash = topologyHash;
 
-    // Draw the lines in between the nodes
-    for (auto i = adjacentPieces.cbegin(), end = adjacentPieces.cend(); i != end; ++i) {
-        QPoint node = i.key();
-        QList<QPoint> neighbors = i.value();
+    // The links and nodes never change during a game, they're one item
+    board = new BoardItem(adjacentPieces, gridSpacing, radius, linesPen, nodesPen, nodesBrush);
+    connect(board, &BoardItem::nodeClicked, this, &MainWindow::nodeClickedHandler);
+    scene->addItem(board);
 
-        float x1 = node.x();
-        float y1 = node.y();
+    qDebug() << "Finished drawing the board.\n";
+}
 
-        for (const auto& neighbor: neighbors) {
-            float x2 = neighbor.x();
-            float y2 = neighbor.y();
+// Deletes the pieces left over from the previous game
+void MainWindow::clearGamePieces(){
+    qDeleteAll(gamePieces);
+    gamePieces.clear();
+}
 
-            scene->addLine(x1 * gridSpacing, y1 * gridSpacing, x2 * gridSpacing, y2 * gridSpacing, linesPen);
-        }
+// Hides the board and shows the loading animation in its place
+void MainWindow::showLoading(){
+    clearGamePieces();
+    if (board) {
+        board->hide();
     }
 
-    // Draw the nodes themselves
-    for (auto i = adjacentPieces.cbegin(), end = adjacentPieces.cend(); i != end; ++i) {
-        QPoint p = i.key();
-
-        float x = p.x() * gridSpacing;
-        float y = p.y() * gridSpacing;
+    if (loadingWidget) {
+        return;
+    }
 
-        Node *node = new Node(x, y, radius, nodesPen, nodesBrush);
+    QMovie *movie = new QMovie(loadingGifPath);
+    movie->setScaledSize(QSize(100, 100));
 
-        connect(node, &Node::nodeClicked, this, &MainWindow::nodeClickedHandler);
+    QLabel *loadingGif = new QLabel();
+    loadingGif->setAttribute(Qt::WA_TranslucentBackground);
+    loadingGif->setMovie(movie);
+    movie->setParent(loadingGif);
 
-        scene->addItem(node);
-    }
+    movie->start();
+    loadingWidget = scene->addWidget(loadingGif);
+}
 
-    qDebug() << "Finished drawing the board.\n";
+void MainWindow::hideLoading(){
+    delete loadingWidget;
+    loadingWidget = nullptr;
 }
 
 
@@ -281,9 +346,9 @@ void MainWindow::startGameBtnClicked(){
     settings.setValue("mode", ui->gameTypeComboBox->currentText());
     settings.setValue("lobby_key", 0);
 
-    // Reconnect to the API server
+    // Ask the API server for a game
     ui->announcementLbl->setText(tr("Connecting to the server..."));
-    boardManager->reconnect();
+    boardManager->requestGame();
 }
 
 // Tries to create a private lobby
@@ -292,9 +357,9 @@ void MainWindow::createLobbyBtnClicked(){
     settings.setValue("mode", "Private Lobby");
     settings.setValue("lobby_key", 0);
 
-    // Reconnect to the API server
+    // Ask the API server for a game
     ui->announcementLbl->setText(tr("Connecting to the server..."));
-    boardManager->reconnect();
+    boardManager->requestGame();
 }
 
 // Tries to join a private lobby
@@ -304,9 +369,9 @@ void MainWindow::joinLobbyBtnClicked(){
     settings.setValue("mode", "Private Lobby");
     settings.setValue("lobby_key", ui->lobbyKeySpinBox->value());
 
-    // Reconnect to the API server
+    // Ask the API server for a game
     ui->announcementLbl->setText(tr("Connecting to the server..."));
-    boardManager->reconnect();
+    boardManager->requestGame();
 }
 
 void MainWindow::settingsButtonClicked(){
@@ -323,12 +388,69 @@ void MainWindow::saveSettingsButtonClicked(){
     settings.setValue("url", ui->urlLineEdit->text());
     settings.setValue("language", ui->language_comboBox->currentText());
 
+    // Reconnect if the server url changed
+    boardManager->updateUrl();
+
     // Retranslate the UI if necessary
     changeLanguage(ui->language_comboBox->currentText());
 
     QMessageBox::information(this, tr("Saved Settings"), tr("Your settings have been saved!"));
 }
 
+// Shows the round-trip latencies measured so far
+void MainWindow::showLatencyDialog(){
+    if (!latencyDialog) {
+        latencyDialog = new LatencyDialog(&boardManager->latency, this);
+    }
+
+    latencyDialog->show();
+    latencyDialog->raise();
+}
+
+// Keeps the frames profiled so far, they're also written on exit
+void MainWindow::exportRenderProfile(){
+    QString profileFile = settings.value("debug/render_profile_file", "render_profile.txt").toString();
+    if (profileFile.isEmpty() || RenderProfiler::frameCount() == 0) {
+        return;
+    }
+
+    if (RenderProfiler::dump(profileFile)) {
+        qDebug() << "Wrote" << RenderProfiler::frameCount() << "profiled frames to" << profileFile;
+    }
+    else {
+        qWarning() << "Couldn't write the render profile to" << profileFile;
+    }
+}
+
+// Starts a trace, or stops it and writes it out
+void MainWindow::toggleTrace(){
+    if (!Tracer::isEnabled()) {
+        Tracer::clear();
+        Tracer::setEnabled(true);
+        ui->statusbar->showMessage(tr("Tracing started."), 3000);
+        return;
+    }
+
+    Tracer::setEnabled(false);
+    exportTrace();
+    Tracer::clear();
+}
+
+void MainWindow::exportTrace(){
+    QString traceFile = settings.value("debug/trace_file", "trace.json").toString();
+    if (traceFile.isEmpty()) {
+        return;
+    }
+
+    int events = Tracer::dump(traceFile);
+    if (events > 0) {
+        qDebug() << "Wrote" << events << "trace events to" << traceFile;
+    }
+    else if (events < 0) {
+        qWarning() << "Couldn't write the trace to" << traceFile;
+    }
+}
+
 void MainWindow::animatePageTransition(QWidget *next, Direction transitionFrom){
     QWidget *current = ui->stackedWidget->currentWidget();
 
@@ -336,6 +458,9 @@ void MainWindow::animatePageTransition(QWidget *next, Direction transitionFrom){
         return;
     }
 
+    // Traced from start to finish
+    const int64_t traceStart = Tracer::isEnabled() ? Tracer::now() : -1;
+
     int w = ui->stackedWidget->width();
     QGraphicsOpacityEffect *fadeIn = new QGraphicsOpacityEffect();
     QGraphicsOpacityEffect *fadeOut = new QGraphicsOpacityEffect();
@@ -385,6 +510,10 @@ void MainWindow::animatePageTransition(QWidget *next, Direction transitionFrom){
         fadeInAnimation->deleteLater();
         fadeOutAnimation->deleteLater();
 
+        if (traceStart >= 0) {
+            Tracer::record("MainWindow::animatePageTransition", "gui", traceStart, Tracer::now() - traceStart);
+        }
+
         updateIdleUI();
     });
 
@@ -395,31 +524,27 @@ void MainWindow::animatePageTransition(QWidget *next, Direction transitionFrom){
     fadeOutAnimation->start();
 }
 
-void MainWindow::nodeClickedHandler(QObject *object) {
-    if(boardManager->gameState != GameState::PLACEMENT) {
+void MainWindow::nodeClickedHandler(QPoint boardPos) {
+    if(boardManager->expectedState() != GameState::PLACEMENT) {
         return;
     }
 
-    Node *node = (Node *)object;
-
-    QPoint boardPos = sceneToBoard(node->nodePos);
     boardManager->placePiece(boardPos.x(), boardPos.y());
 }
 
 void MainWindow::gamePieceReleased(QObject *object){
     GamePiece *piece = (GamePiece *)object;
+    GameState state = boardManager->expectedState();
 
-    if(boardManager->gameState == GameState::FIRST_REMOVAL || boardManager->gameState == GameState::REMOVAL){
+    if(state == GameState::FIRST_REMOVAL || state == GameState::REMOVAL){
         boardManager->removePiece(piece->ID);
     }
 
-    else if(boardManager->gameState == GameState::MOVEMENT) {
+    else if(state == GameState::MOVEMENT) {
         QPoint boardPos = sceneToBoard(piece->currentPos);
         qDebug() << "Piece moved to" << boardPos;
-        if(boardPos != QPoint(-1, -1)){
-            boardManager->movePiece(piece->ID, boardPos.x(), boardPos.y());
-        }
-        else {
+        // Snap the piece back if the move is off the board or rejected locally
+        if(boardPos == QPoint(-1, -1) || !boardManager->movePiece(piece->ID, boardPos.x(), boardPos.y())){
             piece->movePiece(-1, -1);
         }
     }
@@ -427,10 +552,13 @@ void MainWindow::gamePieceReleased(QObject *object){
 
 // *************************** API RESPONSE HANDLERS ********************** //
 void MainWindow::connectedToBoard(){
-    ui->announcementLbl->setText(tr("Connected to Server."));
+    ui->statusbar->clearMessage();
 
-    // Message the API server
-    boardManager->startGame();
+    // The board manager sends any pending game request itself
+    if (boardManager->pendingStart)
+        ui->announcementLbl->setText(tr("Connected to Server."));
+    else
+        updateIdleUI();
 }
 
 void MainWindow::connectionErrorHandler(QString error) {
@@ -438,7 +566,9 @@ void MainWindow::connectionErrorHandler(QString error) {
     QMessageBox::critical(this, "Websocket Error", error);
 }
 
-void MainWindow::startGameResponseHandler(bool success, QString error, bool waiting, uint64_t lobbyKey, QString nextState, uint8_t nextPlayer, QHash<QPoint, QList<QPoint>> adjacentPieces){
+void MainWindow::startGameResponseHandler(bool success, QString error, bool waiting, uint64_t lobbyKey, QString nextState, uint8_t nextPlayer, BoardTopology adjacentPieces, QString topologyHash){
+    Tracer::Scope trace("MainWindow::startGameResponseHandler", "gui");
+
     // Update the game-related text
     updateGameInfoUI(nextState, nextPlayer, "", 0, waiting);
 
@@ -452,28 +582,18 @@ void MainWindow::startGameResponseHandler(bool success, QString error, bool wait
     animatePageTransition(ui->gameInfoFrame_page, RIGHT);
 
     if (waiting) {
-        QMovie *movie = new QMovie(loadingGifPath);
-        movie->setScaledSize(QSize(100, 100));
-
-        QLabel *loadingGif = new QLabel();
-        loadingGif->setAttribute(Qt::WA_TranslucentBackground);
-        loadingGif->setMovie(movie);
-
-        movie->start();
-        scene = ui->graphicsView->scene();
-
-        // Clear the scene and add the loading widget
-        scene->clear();
-        scene->addWidget(loadingGif);
+        showLoading();
     }
 
     else {
-        initBoard(adjacentPieces);
+        initBoard(adjacentPieces, topologyHash);
     }
 
 }
 
-void MainWindow::placePieceResponseHandler(bool success, QString error, uint16_t ID, uint8_t x, uint8_t y, QString nextState, uint8_t nextPlayer, QList<uint16_t> activePieces){
+void MainWindow::placePieceResponseHandler(bool success, QString error, uint16_t ID, uint8_t x, uint8_t y, QString nextState, uint8_t nextPlayer, QBitArray activePieces){
+    Tracer::Scope trace("MainWindow::placePieceResponseHandler", "gui");
+
     // Update the game-related text
     updateGameInfoUI(nextState, nextPlayer, "", 0, false);
 
@@ -482,30 +602,19 @@ void MainWindow::placePieceResponseHandler(bool success, QString error, uint16_t
         return;
     }
 
-    // Get the properties of the new game piece
-    QPointF p = boardToScene(QPoint(x, y));
-    uint8_t player = ID & 0x1;
-
-    qDebug() << "Placing piece at:" << p;
-
-    // Create a new game piece
-    GamePiece *newPiece = new GamePiece(ID, p.x(), p.y(), radius, playerColors[player]);
-
-    // Add the piece to the scene and move it to its home position
-    scene->addItem(newPiece);
-
-    // Store the piece for future use
-    gamePieces.insert(ID, newPiece);
-
-    // Connect the signals from the game piece
-    connect(newPiece, &GamePiece::pieceReleased, this, &MainWindow::gamePieceReleased);
+    // A predicted piece is already on the board
+    if (!gamePieces.contains(ID)) {
+        addGamePiece(ID, QPoint(x, y));
+    }
 
     // Highlight any removable pieces
     if(nextState == "FIRST_REMOVAL")
         highlightPieces(activePieces, false);
 }
 
-void MainWindow::removePieceResponseHandler(bool success, QString error, uint16_t ID, QString nextState, uint8_t nextPlayer, QList<uint16_t> activePieces){
+void MainWindow::removePieceResponseHandler(bool success, QString error, uint16_t ID, QString nextState, uint8_t nextPlayer, QBitArray activePieces){
+    Tracer::Scope trace("MainWindow::removePieceResponseHandler", "gui");
+
     // Update the game-related text
     updateGameInfoUI(nextState, nextPlayer, "", 0, false);
 
@@ -516,20 +625,27 @@ void MainWindow::removePieceResponseHandler(bool success, QString error, uint16_
 
     // Remove the piece from the scene
     GamePiece* piece = gamePieces.take(ID);
-    scene->removeItem(piece);
-    delete piece;
+    if (piece) {
+        scene->removeItem(piece);
+        delete piece;
+    }
 
     // Activates any pieces that could be removed/moved in the next stage
     qDebug() << activePieces;
     highlightPieces(activePieces, nextState == "MOVEMENT");
 }
 
-void MainWindow::movePieceResponseHandler(bool success, QString error, uint16_t ID, uint8_t x, uint8_t y, QString nextState, uint8_t nextPlayer, QList<uint16_t> activePieces){
+void MainWindow::movePieceResponseHandler(bool success, QString error, uint16_t ID, uint8_t x, uint8_t y, QString nextState, uint8_t nextPlayer, QBitArray activePieces){
+    Tracer::Scope trace("MainWindow::movePieceResponseHandler", "gui");
+
     // Update the game-related text
     updateGameInfoUI(nextState, nextPlayer, "", 0, false);
 
     // Get the piece corresponding to the evaluated piece movement
-    GamePiece* piece = gamePieces[ID];
+    GamePiece* piece = gamePieces.value(ID);
+    if (!piece) {
+        return;
+    }
 
     // If piece movement was not approved, move the piece back to its original position
     if (!success){
@@ -548,7 +664,141 @@ void MainWindow::movePieceResponseHandler(bool success, QString error, uint16_t
     highlightPieces(activePieces, nextState == "MOVEMENT");
 }
 
+void MainWindow::activePiecesSyncedHandler(QBitArray activePieces){
+    Tracer::Scope trace("MainWindow::activePiecesSyncedHandler", "gui");
+
+    GameState state = boardManager->gameState;
+
+    // Only pieces that can be moved or removed are ever highlighted
+    if (state == GameState::MOVEMENT || state == GameState::REMOVAL || state == GameState::FIRST_REMOVAL) {
+        highlightPieces(activePieces, state == GameState::MOVEMENT);
+    }
+}
+
+void MainWindow::connectionInterruptedHandler(){
+    ui->statusbar->showMessage(tr("Lost the connection to the server, reconnecting..."));
+}
+
+// Brings the board in line with the server's snapshot after reconnecting
+void MainWindow::gameResumedHandler(QString nextState, uint8_t nextPlayer, PiecePositions pieces, QBitArray activePieces){
+    Tracer::Scope trace("MainWindow::gameResumedHandler", "gui");
+
+    ui->statusbar->showMessage(tr("Reconnected to the server."), 3000);
+    updateGameInfoUI(nextState, nextPlayer, "", 0, false);
+
+    QSet<uint16_t> snapshotIds;
+    for (const PiecePosition &piece : std::as_const(pieces)) {
+        snapshotIds.insert(piece.id);
+
+        GamePiece *existing = gamePieces.value(piece.id);
+        QPointF p = boardToScene(QPoint(piece.x, piece.y));
+
+        // Add pieces that were placed while disconnected
+        if (!existing) {
+            addGamePiece(piece.id, QPoint(piece.x, piece.y));
+        }
+        // Move pieces that aren't where the server has them
+        else if (existing->homePos != p || existing->currentPos != p) {
+            existing->movePiece(p.x(), p.y());
+        }
+
+        // Bring back pieces whose predicted removal never happened
+        if (existing && existing->opacity() < 1) {
+            fadePiece(existing, true);
+        }
+    }
+
+    // Remove pieces that were taken while disconnected
+    for (auto i = gamePieces.begin(); i != gamePieces.end();) {
+        if (snapshotIds.contains(i.key())) {
+            ++i;
+            continue;
+        }
+
+        scene->removeItem(i.value());
+        delete i.value();
+        i = gamePieces.erase(i);
+    }
+
+    bool selecting = nextState == "MOVEMENT" || nextState == "REMOVAL" || nextState == "FIRST_REMOVAL";
+    highlightPieces(selecting ? activePieces : QBitArray(), nextState == "MOVEMENT");
+}
+
+// Shows a local move before the server has confirmed it
+void MainWindow::movePredictedHandler(MovePredictor::Prediction prediction, QBitArray activePieces){
+    GamePiece *piece = gamePieces.value(prediction.pieceId);
+
+    switch (prediction.move.type()) {
+        case Rules::Move::Place:
+            addGamePiece(prediction.pieceId, prediction.to);
+            break;
+        case Rules::Move::Slide:
+            if (piece) {
+                QPointF p = boardToScene(prediction.to);
+                piece->movePiece(p.x(), p.y());
+            }
+            break;
+        case Rules::Move::Remove:
+            if (piece) {
+                fadePiece(piece, false);
+            }
+            break;
+        default:
+            break;
+    }
+
+    highlightPieces(activePieces, boardManager->expectedState() == GameState::MOVEMENT);
+}
+
+// Gives a predicted piece the ID the server assigned to it
+void MainWindow::predictionConfirmedHandler(MovePredictor::Prediction prediction, uint16_t pieceId){
+    GamePiece *piece = gamePieces.take(prediction.pieceId);
+    if (!piece) {
+        return;
+    }
+
+    piece->ID = pieceId;
+    gamePieces.insert(pieceId, piece);
+}
+
+// Animates a mispredicted move back to how the server has the board
+void MainWindow::predictionRolledBackHandler(MovePredictor::Prediction prediction){
+    GamePiece *piece = gamePieces.value(prediction.pieceId);
+    if (!piece) {
+        return;
+    }
+
+    switch (prediction.move.type()) {
+        case Rules::Move::Place: {
+            // Shrink the piece away
+            gamePieces.remove(prediction.pieceId);
+            piece->deactivate();
+
+            AnimationScheduler::instance()->animate(piece, AnimationScheduler::Scale, 0.0, rollbackTime, QEasingCurve::InBack,
+                                                    [piece]() { piece->deleteLater(); });
+            break;
+        }
+        case Rules::Move::Slide: {
+            QPointF p = boardToScene(prediction.from);
+            piece->movePiece(p.x(), p.y());
+            break;
+        }
+        case Rules::Move::Remove:
+            fadePiece(piece, true);
+            break;
+        default:
+            break;
+    }
+
+    // Go back to the server's idea of what can be selected
+    GameState state = boardManager->gameState;
+    bool selecting = state == GameState::MOVEMENT || state == GameState::REMOVAL || state == GameState::FIRST_REMOVAL;
+    highlightPieces(selecting ? boardManager->activePieces.bits() : QBitArray(), state == GameState::MOVEMENT);
+}
+
 void MainWindow::quitGameResponseHandler(bool success, QString error, uint8_t winner, uint8_t flag, bool waiting){
+    Tracer::Scope trace("MainWindow::quitGameResponseHandler", "gui");
+
     if (!success) {
         qDebug() << "Couldn't end the game: " << error;
         return;
@@ -558,7 +808,7 @@ void MainWindow::quitGameResponseHandler(bool success, QString error, uint8_t wi
     updateGameInfoUI("STOPPED", boardManager->currentTurn, "", flag, waiting);
 
     // Clear the scene if exiting the waiting list
-    if(flag == 0x1) scene->clear();
+    if(flag == 0x1) hideLoading();
 }
 
 // ************************* BOARD-SCENE TRANSLATIONS ********************** //
@@ -581,18 +831,49 @@ QPointF MainWindow::boardToScene(QPoint boardPoint){
     return QPointF(boardPoint.x() * gridSpacing, boardPoint.y() * gridSpacing);
 }
 
+// Creates a piece at its position on the board
+GamePiece *MainWindow::addGamePiece(uint16_t ID, QPoint boardPos){
+    // Get the properties of the new game piece
+    QPointF p = boardToScene(boardPos);
+    uint8_t player = ID & 0x1;
+
+    qDebug() << "Placing piece at:" << p;
+
+    // Create a new game piece
+    GamePiece *newPiece = new GamePiece(ID, p.x(), p.y(), radius, playerColors[player]);
+
+    // Add the piece to the scene and move it to its home position
+    scene->addItem(newPiece);
+
+    // Store the piece for future use
+    gamePieces.insert(ID, newPiece);
+
+    // Connect the signals from the game piece
+    connect(newPiece, &GamePiece::pieceReleased, this, &MainWindow::gamePieceReleased);
+
+    return newPiece;
+}
+
+
+// Fades a piece out while its removal is waiting on the server, or back in
+void MainWindow::fadePiece(GamePiece *piece, bool visible){
+    if (!visible) {
+        piece->deactivate();
+    }
+
+    AnimationScheduler::instance()->animate(piece, AnimationScheduler::Opacity, visible ? 1.0 : 0.0, rollbackTime);
+}
+
+void MainWindow::highlightPieces(const QBitArray &activePieces, bool isMovable) {
+    Tracer::Scope trace("MainWindow::highlightPieces", "gui");
 
-void MainWindow::highlightPieces(QList<uint16_t> activePieces, bool isMovable) {
     for (auto i = gamePieces.cbegin(), end = gamePieces.cend(); i != end; i++) {
-        // Activates the game piece if it's in the activePieces list
-        if (activePieces.contains(i.key())) {
+        // Activates the game piece if it's in the activePieces set
+        if (i.key() < activePieces.size() && activePieces.testBit(i.key())) {
             i.value()->activate(isMovable);
         }
         // Deactivate all other game pieces
         else
             i.value()->deactivate();
     }
-
-    // Update the scene to show changes
-    scene->update();
 }
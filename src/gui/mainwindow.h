@@ -9,8 +9,13 @@
 #include <QHash>
 #include <QList>
 #include <QColor>
+#include <QBitArray>
 #include "../backend/boardmanager.h"
 #include "../backend/gamepiece.h"
+#include "../backend/boarditem.h"
+#include "framemonitor.h"
+#include "latencydialog.h"
+#include "profileroverlay.h"
 
 QT_BEGIN_NAMESPACE
 namespace Ui { class MainWindow; }
@@ -33,11 +38,19 @@ public slots:
     // API response handlers
     void connectedToBoard();
     void connectionErrorHandler(QString error);
-    void startGameResponseHandler(bool success, QString error, bool waiting, uint64_t lobbyKey, QString nextState, uint8_t nextPlayer,  QHash<QPoint, QList<QPoint>> adjacentPieces);
-    void placePieceResponseHandler(bool success, QString error, uint16_t ID, uint8_t x, uint8_t y, QString nextState, uint8_t nextPlayer, QList<uint16_t> activePieces);
-    void removePieceResponseHandler(bool success, QString error, uint16_t ID, QString nextState, uint8_t nextPlayer, QList<uint16_t> activePieces);
-    void movePieceResponseHandler(bool success, QString error, uint16_t ID, uint8_t x, uint8_t y, QString nextState, uint8_t nextPlayer, QList<uint16_t> activePieces);
+    void startGameResponseHandler(bool success, QString error, bool waiting, uint64_t lobbyKey, QString nextState, uint8_t nextPlayer, BoardTopology adjacentPieces, QString topologyHash);
+    void placePieceResponseHandler(bool success, QString error, uint16_t ID, uint8_t x, uint8_t y, QString nextState, uint8_t nextPlayer, QBitArray activePieces);
+    void removePieceResponseHandler(bool success, QString error, uint16_t ID, QString nextState, uint8_t nextPlayer, QBitArray activePieces);
+    void movePieceResponseHandler(bool success, QString error, uint16_t ID, uint8_t x, uint8_t y, QString nextState, uint8_t nextPlayer, QBitArray activePieces);
     void quitGameResponseHandler(bool success, QString error, uint8_t winner, uint8_t flag, bool waiting);
+    void activePiecesSyncedHandler(QBitArray activePieces);
+    void connectionInterruptedHandler();
+    void gameResumedHandler(QString nextState, uint8_t nextPlayer, PiecePositions pieces, QBitArray activePieces);
+
+    // Move prediction handlers
+    void movePredictedHandler(MovePredictor::Prediction prediction, QBitArray activePieces);
+    void predictionConfirmedHandler(MovePredictor::Prediction prediction, uint16_t pieceId);
+    void predictionRolledBackHandler(MovePredictor::Prediction prediction);
 
 private:
     Ui::MainWindow *ui;
@@ -46,7 +59,7 @@ private:
 
     const QString loadingGifPath = ":/images/loading.gif";
     QGraphicsScene *scene;
-    QGraphicsProxyWidget *loadingWidget;
+    QGraphicsProxyWidget *loadingWidget = nullptr;
     QSettings settings = QSettings("SA LLC", "Shax Desktop Client");
 
     QWidget currentFrame;
@@ -56,6 +69,9 @@ private:
     QString url;
 
     BoardManager *boardManager;
+    FrameMonitor frameMonitor;
+    LatencyDialog *latencyDialog = nullptr;
+    ProfilerOverlay *profilerOverlay = nullptr;
 
     // Default Settings
     const float marginOfError_default = 0.2;
@@ -67,6 +83,7 @@ private:
     float penWidth = 3;
     float gridSpacing = 70;
     int pageTransitionTime = 200;
+    int rollbackTime = 250;
 
     QColor playerColors[2];
     QColor p1_color = QColor(140, 75, 50);
@@ -79,14 +96,21 @@ private:
     QHash<QPoint, QList<QPoint>> adjacentPieces;
     QHash<uint16_t,GamePiece*> gamePieces;
 
+    // Static board, kept between games played on the same board
+    BoardItem *board = nullptr;
+    QString boardHash;
+
     // Init methods
     void connectAll();
-    void initBoard(QHash<QPoint, QList<QPoint>> adjacentPieces);
+    void initBoard(BoardTopology adjacentPieces, QString topologyHash);
+    void clearGamePieces();
+    void showLoading();
+    void hideLoading();
 
     // UI Event handlers
 //    void closeEvent(QCloseEvent *event);
     void gamePieceReleased(QObject *object);
-    void nodeClickedHandler(QObject *object);
+    void nodeClickedHandler(QPoint boardPos);
     void findGameBtnClicked();
     void lobbyBtnClicked();
     void backBtnClicked();
@@ -96,6 +120,10 @@ private:
     void gameBtnClicked();
     void settingsButtonClicked();
     void saveSettingsButtonClicked();
+    void showLatencyDialog();
+    void exportRenderProfile();
+    void toggleTrace();
+    void exportTrace();
     void animatePageTransition(QWidget *nextWidget, Direction transitionFrom);
 
 
@@ -108,7 +136,10 @@ private:
     QPoint sceneToBoard(QPointF scenePoint);
     QPointF boardToScene(QPoint boardPoint);
 
+    GamePiece *addGamePiece(uint16_t ID, QPoint boardPos);
+    void fadePiece(GamePiece *piece, bool visible);
+
     // Highlights movable/removable pieces
-    void highlightPieces(QList<uint16_t> activePieces, bool isMovable);
+    void highlightPieces(const QBitArray &activePieces, bool isMovable);
 };
 #endif // MAINWINDOW_H
@@ -0,0 +1,132 @@
+#include "profileroverlay.h"
+#include "../backend/renderprofiler.h"
+#include <QPainter>
+#include <QPaintEvent>
+
+ProfilerOverlay::ProfilerOverlay(QGraphicsView *view)
+    : QWidget{view->viewport()}
+{
+    viewport = view->viewport();
+    viewport->installEventFilter(this);
+
+    setAttribute(Qt::WA_TransparentForMouseEvents);
+    setGeometry(viewport->rect());
+    hide();
+
+    refreshTimer.setInterval(REFRESH_INTERVAL);
+    QObject::connect(&refreshTimer, &QTimer::timeout, this, [this]{
+        update(panelRect());
+    });
+}
+
+void ProfilerOverlay::setActive(bool active){
+    RenderProfiler::setEnabled(active);
+    setVisible(active);
+    if (active) {
+        raise();
+        refreshTimer.start();
+    }
+    else {
+        refreshTimer.stop();
+    }
+}
+
+QRect ProfilerOverlay::panelRect() const{
+    return QRect(8, 8, PANEL_WIDTH, PANEL_HEIGHT);
+}
+
+
+// ********************************** EVENT HANDLERS ******************************** //
+bool ProfilerOverlay::eventFilter(QObject *watched, QEvent *event){
+    if (watched == viewport) {
+        if (event->type() == QEvent::Paint) {
+            RenderProfiler::beginFrame();
+        }
+        else if (event->type() == QEvent::Resize) {
+            setGeometry(viewport->rect());
+        }
+    }
+    return QWidget::eventFilter(watched, event);
+}
+
+// Children are painted after their parent, so the view is done by now
+void ProfilerOverlay::paintEvent(QPaintEvent *event){
+    RenderProfiler::endFrame();
+
+    const QRect panel = panelRect();
+    if (!event->rect().intersects(panel)) {
+        return;
+    }
+
+    // Averages over the last second of frames
+    const int count = RenderProfiler::frameCount();
+    int frames = 0;
+    int64_t totalInterval = 0, maxInterval = 0, totalPaint = 0;
+    uint64_t totalItems = 0;
+    int64_t totalSections[RenderProfiler::SectionCount] = {};
+    for (int age = 0; age < count && totalInterval < 1000000000LL; age++) {
+        const RenderProfiler::Frame &f = RenderProfiler::frame(age);
+        frames++;
+        totalInterval += f.interval;
+        maxInterval = qMax(maxInterval, f.interval);
+        totalPaint += f.paint;
+        totalItems += f.items;
+        for (int s = 0; s < RenderProfiler::SectionCount; s++) {
+            totalSections[s] += f.sections[s];
+        }
+    }
+
+    auto ms = [frames](int64_t ns) {
+        return QString::number(frames ? ns / 1e6 / frames : 0, 'f', 2);
+    };
+
+    QStringList lines;
+    lines << tr("FPS %1, frame %2 ms (max %3)")
+                 .arg(totalInterval > 0 ? frames * 1e9 / totalInterval : 0, 0, 'f', 1)
+                 .arg(ms(totalInterval))
+                 .arg(maxInterval / 1e6, 0, 'f', 1);
+    lines << tr("Paint %1 ms, %2 items").arg(ms(totalPaint)).arg(frames ? double(totalItems) / frames : 0, 0, 'f', 1);
+    lines << tr("Pieces %1 ms, board %2 ms").arg(ms(totalSections[RenderProfiler::PiecePaint]),
+                                                ms(totalSections[RenderProfiler::BoardPaint]));
+    lines << tr("Animation %1 ms, protocol %2 ms").arg(ms(totalSections[RenderProfiler::Animation]),
+                                                      ms(totalSections[RenderProfiler::Protocol]));
+    if (RenderProfiler::unmatchedFrames() > 0) {
+        lines << tr("%1 frames out of order").arg(RenderProfiler::unmatchedFrames());
+    }
+
+    QPainter painter(this);
+    painter.fillRect(panel, QColor(0, 0, 0, 170));
+
+    painter.setPen(Qt::white);
+    QFont font = painter.font();
+    font.setPointSize(9);
+    painter.setFont(font);
+    const int lineHeight = painter.fontMetrics().height();
+    QPoint textPos = panel.topLeft() + QPoint(6, 4 + painter.fontMetrics().ascent());
+    for (const QString &line : std::as_const(lines)) {
+        painter.drawText(textPos, line);
+        textPos.ry() += lineHeight;
+    }
+
+    // Frame times, newest on the right. Frames that missed a refresh at
+    // 60 Hz are red.
+    const QRect graph(panel.left() + 6, textPos.y(), panel.width() - 12, panel.bottom() - 6 - textPos.y());
+    if (graph.height() <= 0) {
+        return;
+    }
+    const double barWidth = double(graph.width()) / GRAPH_FRAMES;
+    auto heightOf = [&](double ms) {
+        return qMin(ms, GRAPH_RANGE) / GRAPH_RANGE * graph.height();
+    };
+
+    for (int age = 0; age < qMin(count, GRAPH_FRAMES); age++) {
+        const double frameMs = RenderProfiler::frame(age).interval / 1e6;
+        const double h = heightOf(frameMs);
+        QRectF bar(graph.right() - (age + 1) * barWidth, graph.bottom() - h, barWidth, h);
+        painter.fillRect(bar, frameMs > 2 * 1000.0 / 60 ? QColor(220, 60, 60) : QColor(90, 200, 90));
+    }
+
+    painter.setPen(QColor(255, 255, 255, 120));
+    const double target = graph.bottom() - heightOf(1000.0 / 60);
+    painter.drawLine(QPointF(graph.left(), target), QPointF(graph.right(), target));
+}
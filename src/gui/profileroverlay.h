@@ -0,0 +1,41 @@
+#ifndef PROFILEROVERLAY_H
+#define PROFILEROVERLAY_H
+
+#include <QWidget>
+#include <QGraphicsView>
+#include <QTimer>
+
+// Debug panel drawn over the board view with the RenderProfiler's numbers:
+// fps, a graph of the latest frame times, items painted and the time spent
+// in each section.
+// It covers the whole viewport and paints right after it, which is how the
+// profiler finds where each frame's paint starts and ends.
+class ProfilerOverlay : public QWidget
+{
+    Q_OBJECT
+public:
+    explicit ProfilerOverlay(QGraphicsView *view);
+
+    // Shows the panel and turns the profiler on, or both off
+    void setActive(bool active);
+
+protected:
+    bool eventFilter(QObject *watched, QEvent *event) override;
+    void paintEvent(QPaintEvent *event) override;
+
+private:
+    // The panel is refreshed this often when nothing else repaints the view
+    const int REFRESH_INTERVAL = 500;
+    const int GRAPH_FRAMES = 120;
+    const int PANEL_WIDTH = 260;
+    const int PANEL_HEIGHT = 150;
+    // Bars are cut off at this many ms
+    const double GRAPH_RANGE = 50;
+
+    QWidget *viewport;
+    QTimer refreshTimer;
+
+    QRect panelRect() const;
+};
+
+#endif // PROFILEROVERLAY_H
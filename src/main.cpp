@@ -1,74 +1,66 @@
 #include "gui/mainwindow.h"
+#include "backend/asynclogger.h"
 
 #include <QApplication>
 #include <QLocale>
 #include <QTranslator>
 #include <QFile>
 #include <QtMessageHandler>
+#include <csignal>
 
 QString logFileName = "log.txt";
 
-QFile logFile(logFileName);
+AsyncLogger logger(logFileName);
 QtMessageHandler originalHandler = nullptr;
 
 
 void logToFile(QtMsgType type, const QMessageLogContext &context, const QString &msg)
 {
-	// If the log file can't be opened, just use the default logging method
-	if(!logFile.open(QIODevice::Append, QFileDevice::WriteUser | QFileDevice::ReadUser)){
+	// Fall back to the default logging method if the message can't be queued
+	if(!logger.log(type, msg)){
 		originalHandler(type, context, msg);
-		return;
 	}
 
-    QTextStream stream(&logFile);
-
-	// Construct the log string
-    QString level;
-    switch (type) {
-		case QtDebugMsg:
-			level = "DEBUG";
-			break;
-		case QtInfoMsg:
-			level = "INFO";
-			break;
-		case QtWarningMsg:
-			level = "WARNING";
-			break;
-		case QtCriticalMsg:
-			level = "CRITICAL";
-			break;
-		case QtFatalMsg:
-			level = "FATAL";
-			break;
-    }
-
-    stream << QDateTime::currentDateTime().toString("yyyy-MM-dd hh:mm:ss.zzz")
-           << " [" << level << "] "
-           << msg << "\n";
+	// The application aborts right after a fatal message, write everything out now
+	if(type == QtFatalMsg){
+		logger.flush();
+	}
+}
 
-	// Flush the log message
-    stream.flush();
+// Writes out the lines still queued before the application dies.
+// The logger's crash path is async-signal-safe, nothing else may go here.
+void writeLogOnCrash(int sig)
+{
+	logger.writeOnCrash();
 
-	// Close the log file
-	logFile.close();
+	std::signal(sig, SIG_DFL);
+	std::raise(sig);
 }
 
 int main(int argc, char *argv[])
 {
 	QApplication a(argc, argv);
 
-	// Delete the previous backup log
-	QFile::remove(logFileName + ".bak");
+	// Rotate the previous logs and start the background writer.
+	// Hold onto the original message handler as a backup option
+	if(logger.start()){
+		originalHandler = qInstallMessageHandler(logToFile);
 
-	// Backup the previous log file
-	QFile::rename(logFileName, logFileName + ".bak");
+		std::signal(SIGSEGV, writeLogOnCrash);
+		std::signal(SIGABRT, writeLogOnCrash);
+		std::signal(SIGFPE, writeLogOnCrash);
+		std::signal(SIGILL, writeLogOnCrash);
+	}
 
-	// Attach the new message handler
-	// Hold onto the original message handler as a backup option
-	originalHandler = qInstallMessageHandler(logToFile);
+	int result;
+	{
+		MainWindow w;
+		QApplication::setStyle("fusion");
+		w.show();
+		result = a.exec();
+	}
 
-	MainWindow w;
-	QApplication::setStyle("fusion");
-	w.show();
-	return a.exec();
+	// Write out everything logged while shutting down
+	logger.stop();
+	return result;
 }
@@ -0,0 +1,332 @@
+// Self-play tournament between engine configurations.
+//
+// Usage: shax-arena --engine SPEC --engine SPEC [...] [--games N] [--threads N]
+//                   [--random-plies N] [--seed N] [--out FILE]
+//
+// SPEC is a comma separated list of key=value settings:
+//   name      - shown in the results (default: engine1, engine2, ...)
+//   movetime  - ms per move (default 100)
+//   depth     - depth limit per move
+//   nodes     - node limit per move
+//   hash      - transposition table size in MB (default 16)
+//   book      - opening book file
+//   tb        - endgame tablebase directory
+//   material, mill, threat, mobility, blocked - evaluation weights
+//
+// Every pair of engines plays --games games (default 100, rounded up to an
+// even number) on the standard board. Games come in pairs that start from the same random opening of
+// --random-plies moves (default 4), with the engines swapping sides, so
+// neither is favoured by the opening. Each thread plays one game at a time.
+//
+// Results are reported as the first engine's score, Elo difference and 95%
+// confidence interval. Every game is written to --out (default
+// arena.games), one per line:
+//   <game> <player 1> <player 2> <result> <moves>
+// where the result is 1-0, 0-1 or 1/2 and the moves are the engine's 16-bit
+// moves in hex, 4 digits each with no separator.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "rules/search.h"
+#include "rules/openingbook.h"
+
+using namespace Rules;
+
+namespace {
+
+// Games still going after this many moves are drawn
+const int MAX_GAME_PLIES = 300;
+
+struct Engine {
+    std::string name;
+    SearchLimits limits;
+    int hashMb = 16;
+    EvalWeights weights;
+    std::string bookPath;
+    std::string tablebasePath;
+
+    // Shared by every thread, they're only read
+    std::unique_ptr<OpeningBook> book;
+    std::unique_ptr<Tablebase> tablebase;
+};
+
+struct PairStats {
+    int first;
+    int second;
+    // From the first engine's side
+    int wins = 0;
+    int draws = 0;
+    int losses = 0;
+};
+
+struct Game {
+    int pair;
+    uint32_t opening;
+    // Whether the second engine of the pair plays first
+    bool swapped;
+};
+
+bool parseEngine(const std::string &spec, int number, Engine &engine, std::string &error){
+    engine.name = "engine" + std::to_string(number);
+    engine.limits.timeMs = 100;
+
+    std::istringstream in(spec);
+    std::string setting;
+    while (std::getline(in, setting, ',')) {
+        size_t equals = setting.find('=');
+        if (equals == std::string::npos) {
+            error = "expected key=value, got " + setting;
+            return false;
+        }
+
+        std::string key = setting.substr(0, equals);
+        std::string value = setting.substr(equals + 1);
+        if (key == "name")
+            engine.name = value;
+        else if (key == "movetime")
+            engine.limits.timeMs = atoi(value.c_str());
+        else if (key == "depth")
+            engine.limits.maxDepth = atoi(value.c_str());
+        else if (key == "nodes")
+            engine.limits.maxNodes = strtoull(value.c_str(), nullptr, 10);
+        else if (key == "hash")
+            engine.hashMb = std::max(1, atoi(value.c_str()));
+        else if (key == "book")
+            engine.bookPath = value;
+        else if (key == "tb")
+            engine.tablebasePath = value;
+        else if (key == "material")
+            engine.weights.material = atoi(value.c_str());
+        else if (key == "mill")
+            engine.weights.mill = atoi(value.c_str());
+        else if (key == "threat")
+            engine.weights.threat = atoi(value.c_str());
+        else if (key == "mobility")
+            engine.weights.mobility = atoi(value.c_str());
+        else if (key == "blocked")
+            engine.weights.blocked = atoi(value.c_str());
+        else {
+            error = "unknown setting " + key;
+            return false;
+        }
+    }
+    return true;
+}
+
+// Elo difference that gives an expected score
+double eloOf(double score){
+    score = std::min(std::max(score, 1e-6), 1 - 1e-6);
+    return -400 * log10(1 / score - 1);
+}
+
+void report(const std::vector<Engine> &engines, const PairStats &stats){
+    const int games = stats.wins + stats.draws + stats.losses;
+    if (games == 0) {
+        return;
+    }
+
+    // 95% interval of the score, from the spread of the game results
+    const double score = (stats.wins + 0.5 * stats.draws) / games;
+    const double variance = (stats.wins * pow(1 - score, 2) + stats.draws * pow(0.5 - score, 2) + stats.losses * pow(score, 2)) / games;
+    const double margin = 1.96 * sqrt(variance / games);
+
+    printf("%s vs %s: %d games, +%d =%d -%d, score %.1f%%, Elo %+.1f [%+.1f, %+.1f]\n",
+           engines[stats.first].name.c_str(), engines[stats.second].name.c_str(), games,
+           stats.wins, stats.draws, stats.losses, 100 * score,
+           eloOf(score), eloOf(score - margin), eloOf(score + margin));
+}
+
+// Plays one game, returns the winner (0 or 1) or -1 for a draw
+int playGame(const Geometry &geometry, const Engine *players[2], TranspositionTable *tables[2], uint32_t opening, std::string &moves){
+    Position position = Position::start(geometry);
+    std::mt19937 random(opening);
+    int randomPlies = (int)(opening >> 24);
+
+    for (int ply = 0; ply < MAX_GAME_PLIES && position.phase != Phase::Over; ply++) {
+        const Engine &engine = *players[position.side];
+        Move move;
+
+        if (ply < randomPlies) {
+            MoveList legal;
+            generateMoves(geometry, position, legal);
+            move = legal[random() % legal.size()];
+        }
+        else if (engine.book) {
+            move = engine.book->pick(geometry, position, random());
+        }
+
+        if (move == Move()) {
+            Search search(geometry, tables[position.side]);
+            search.setTablebase(engine.tablebase.get());
+            search.setWeights(engine.weights);
+            move = search.run(position, engine.limits).best;
+        }
+
+        char hex[8];
+        snprintf(hex, sizeof(hex), "%04x", move.raw());
+        moves += hex;
+        position = play(geometry, position, move);
+    }
+
+    return position.phase == Phase::Over ? position.winner : -1;
+}
+
+} // namespace
+
+int main(int argc, char *argv[]){
+    std::vector<Engine> engines;
+    int gamesPerPair = 100;
+    int threadCount = (int)std::max(1u, std::thread::hardware_concurrency());
+    int randomPlies = 4;
+    uint32_t seed = 1;
+    std::string path = "arena.games";
+    std::string error;
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--engine") && i + 1 < argc) {
+            engines.emplace_back();
+            if (!parseEngine(argv[++i], (int)engines.size(), engines.back(), error)) {
+                fprintf(stderr, "Bad engine: %s\n", error.c_str());
+                return 1;
+            }
+        }
+        else if (!strcmp(argv[i], "--games") && i + 1 < argc)
+            gamesPerPair = std::max(2, atoi(argv[++i]));
+        else if (!strcmp(argv[i], "--threads") && i + 1 < argc)
+            threadCount = std::max(1, atoi(argv[++i]));
+        else if (!strcmp(argv[i], "--random-plies") && i + 1 < argc)
+            randomPlies = std::min(std::max(0, atoi(argv[++i])), 255);
+        else if (!strcmp(argv[i], "--seed") && i + 1 < argc)
+            seed = (uint32_t)strtoul(argv[++i], nullptr, 10);
+        else if (!strcmp(argv[i], "--out") && i + 1 < argc)
+            path = argv[++i];
+        else {
+            fprintf(stderr, "Usage: %s --engine SPEC --engine SPEC [...] [--games N] [--threads N] [--random-plies N] [--seed N] [--out FILE]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    if (engines.size() < 2) {
+        fprintf(stderr, "At least two engines are needed\n");
+        return 1;
+    }
+
+    // Each opening is played from both sides
+    if (gamesPerPair % 2 != 0) {
+        gamesPerPair++;
+        printf("Playing %d games per pair, openings come in pairs\n", gamesPerPair);
+    }
+
+    Geometry geometry = Geometry::standard();
+    for (Engine &engine : engines) {
+        if (!engine.bookPath.empty()) {
+            engine.book = std::make_unique<OpeningBook>();
+            if (!engine.book->open(engine.bookPath, geometry)) {
+                fprintf(stderr, "Couldn't open the book %s\n", engine.bookPath.c_str());
+                return 1;
+            }
+        }
+        if (!engine.tablebasePath.empty()) {
+            engine.tablebase = std::make_unique<Tablebase>();
+            printf("%s: %d endgame tables\n", engine.name.c_str(), engine.tablebase->open(engine.tablebasePath, geometry));
+        }
+    }
+
+    // Round robin, each opening played once from each side
+    std::vector<PairStats> pairs;
+    std::vector<Game> games;
+    std::mt19937 openings(seed);
+    for (int a = 0; a < (int)engines.size(); a++) {
+        for (int b = a + 1; b < (int)engines.size(); b++) {
+            pairs.push_back({a, b});
+            for (int g = 0; g < gamesPerPair / 2; g++) {
+                // The random ply count travels in the top byte
+                uint32_t opening = (openings() & 0xffffff) | (uint32_t)randomPlies << 24;
+                games.push_back({(int)pairs.size() - 1, opening, false});
+                games.push_back({(int)pairs.size() - 1, opening, true});
+            }
+        }
+    }
+
+    FILE *records = fopen(path.c_str(), "w");
+    if (!records) {
+        fprintf(stderr, "Couldn't open %s\n", path.c_str());
+        return 1;
+    }
+
+    std::atomic<size_t> nextGame{0};
+    std::mutex resultsMutex;
+    size_t finished = 0;
+    auto start = std::chrono::steady_clock::now();
+
+    auto work = [&]{
+        // Each thread has its own tables, searches don't share anything
+        std::vector<std::unique_ptr<TranspositionTable>> tables;
+        for (const Engine &engine : engines) {
+            tables.push_back(std::make_unique<TranspositionTable>(engine.hashMb));
+        }
+
+        for (size_t i = nextGame++; i < games.size(); i = nextGame++) {
+            const Game &game = games[i];
+            PairStats &pair = pairs[game.pair];
+            const int first = game.swapped ? pair.second : pair.first;
+            const int second = game.swapped ? pair.first : pair.second;
+
+            const Engine *players[2] = {&engines[first], &engines[second]};
+            TranspositionTable *gameTables[2] = {tables[first].get(), tables[second].get()};
+            gameTables[0]->clear();
+            gameTables[1]->clear();
+
+            std::string moves;
+            int winner = playGame(geometry, players, gameTables, game.opening, moves);
+
+            std::lock_guard<std::mutex> locker(resultsMutex);
+            // Scored for the pair's first engine
+            int pairWinner = winner < 0 ? -1 : (winner == 0) != game.swapped ? 0 : 1;
+            if (pairWinner < 0)
+                pair.draws++;
+            else if (pairWinner == 0)
+                pair.wins++;
+            else
+                pair.losses++;
+
+            fprintf(records, "%zu %s %s %s %s\n", i, players[0]->name.c_str(), players[1]->name.c_str(),
+                    winner < 0 ? "1/2" : winner == 0 ? "1-0" : "0-1", moves.c_str());
+
+            finished++;
+            if (finished % 20 == 0 || finished == games.size()) {
+                printf("%zu/%zu games\n", finished, games.size());
+                fflush(stdout);
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (int i = 1; i < threadCount; i++) {
+        threads.emplace_back(work);
+    }
+    work();
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+    fclose(records);
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    printf("%zu games in %.1f s with %d threads, written to %s\n", games.size(), seconds, threadCount, path.c_str());
+    for (const PairStats &pair : pairs) {
+        report(engines, pair);
+    }
+    return 0;
+}
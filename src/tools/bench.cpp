@@ -0,0 +1,189 @@
+// Engine benchmarks on a fixed set of positions searched to a fixed depth.
+//
+// Usage: shax-bench [--depth N] [--tt-mb N] [--positions N] [--scaling] [--eval]
+//
+// By default the positions are searched without and then with the
+// transposition table. --scaling instead searches them with 1, 2, 4, 8 and
+// 16 threads and reports the speedup of each over one thread. --eval times
+// the static evaluation of the positions with each kernel the CPU supports,
+// in batches of several sizes, and checks they all agree with the scalar one.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <vector>
+#include "rules/search.h"
+
+using namespace Rules;
+
+namespace {
+
+struct Totals {
+    uint64_t nodes = 0;
+    uint64_t probes = 0;
+    uint64_t hits = 0;
+    double seconds = 0;
+};
+
+// Positions from random games, spread over the placement and movement phases
+std::vector<Position> testPositions(const Geometry &geometry, int count){
+    std::vector<Position> positions;
+    std::mt19937 random(12345);
+
+    while ((int)positions.size() < count) {
+        Position position = Position::start(geometry);
+        int plies = 4 + (int)(random() % 40);
+
+        for (int ply = 0; ply < plies && position.phase != Phase::Over; ply++) {
+            MoveList moves;
+            generateMoves(geometry, position, moves);
+            position = play(geometry, position, moves[random() % moves.size()]);
+        }
+
+        if (position.phase != Phase::Over) {
+            positions.push_back(position);
+        }
+    }
+    return positions;
+}
+
+Totals run(const Geometry &geometry, const std::vector<Position> &positions, int depth, int threads, TranspositionTable *table){
+    Totals totals;
+    SearchLimits limits;
+    limits.maxDepth = depth;
+    limits.timeMs = 0;
+    limits.threads = threads;
+
+    for (const Position &position : positions) {
+        // Every position starts from an empty table so they're measured alike
+        if (table) {
+            table->clear();
+        }
+
+        Search search(geometry, table);
+        auto start = std::chrono::steady_clock::now();
+        SearchResult result = search.run(position, limits);
+        totals.seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        totals.nodes += result.nodes;
+        totals.probes += result.ttProbes;
+        totals.hits += result.ttHits;
+    }
+    return totals;
+}
+
+void report(const char *name, const Totals &totals){
+    printf("%-10s %12llu nodes %9.3f s %10.0f nodes/s", name, (unsigned long long)totals.nodes, totals.seconds, totals.nodes / totals.seconds);
+    if (totals.probes > 0) {
+        printf("   hit rate %5.1f%%", 100.0 * totals.hits / totals.probes);
+    }
+    printf("\n");
+}
+
+void compareTable(const Geometry &geometry, const std::vector<Position> &positions, int depth, TranspositionTable &table){
+    Totals without = run(geometry, positions, depth, 1, nullptr);
+    report("no table", without);
+
+    Totals with = run(geometry, positions, depth, 1, &table);
+    report("table", with);
+
+    printf("time to depth %.2fx faster, %.2fx fewer nodes\n", without.seconds / with.seconds, (double)without.nodes / with.nodes);
+}
+
+// Lazy SMP gains come from reaching the same depth sooner, so that's what's compared
+void scaling(const Geometry &geometry, const std::vector<Position> &positions, int depth, TranspositionTable &table){
+    Totals single;
+
+    for (int threads = 1; threads <= 16; threads *= 2) {
+        Totals totals = run(geometry, positions, depth, threads, &table);
+        if (threads == 1) {
+            single = totals;
+        }
+
+        char name[16];
+        snprintf(name, sizeof(name), "%d thr", threads);
+        report(name, totals);
+        printf("           speedup %.2fx, nodes/s %.2fx\n", single.seconds / totals.seconds,
+               (totals.nodes / totals.seconds) / (single.nodes / single.seconds));
+    }
+}
+
+// Batches the size of a node's children, a placement node's and a single one
+void evalKernels(const Geometry &geometry, const std::vector<Position> &positions){
+    const int ROUNDS = 200;
+    const EvalWeights weights;
+    std::vector<int> expected(positions.size()), scores(positions.size());
+    evaluateBatch(geometry, positions.data(), (int)positions.size(), weights, expected.data(), EvalKernel::Scalar);
+
+    for (int size : {1, 4, 8, 24, (int)positions.size()}) {
+        double scalarSeconds = 0;
+        for (EvalKernel kernel : {EvalKernel::Scalar, EvalKernel::Sse41, EvalKernel::Avx2}) {
+            if (!isSupported(kernel)) {
+                continue;
+            }
+
+            auto start = std::chrono::steady_clock::now();
+            for (int round = 0; round < ROUNDS; round++) {
+                for (size_t first = 0; first < positions.size(); first += size) {
+                    int count = (int)std::min<size_t>(size, positions.size() - first);
+                    evaluateBatch(geometry, &positions[first], count, weights, &scores[first], kernel);
+                }
+            }
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            if (kernel == EvalKernel::Scalar) {
+                scalarSeconds = seconds;
+            }
+
+            bool same = scores == expected;
+            printf("batch %-5d %-7s %7.1f ns/position  %.2fx  %s\n", size, kernelName(kernel),
+                   1e9 * seconds / (ROUNDS * positions.size()), scalarSeconds / seconds, same ? "ok" : "MISMATCH");
+        }
+    }
+}
+
+} // namespace
+
+int main(int argc, char *argv[]){
+    int depth = 7;
+    int megabytes = 16;
+    int count = 50;
+    bool scalingMode = false;
+    bool evalMode = false;
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--depth") && i + 1 < argc)
+            depth = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--tt-mb") && i + 1 < argc)
+            megabytes = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--positions") && i + 1 < argc)
+            count = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--scaling"))
+            scalingMode = true;
+        else if (!strcmp(argv[i], "--eval"))
+            evalMode = true;
+        else {
+            fprintf(stderr, "Usage: %s [--depth N] [--tt-mb N] [--positions N] [--scaling] [--eval]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    Geometry geometry = Geometry::standard();
+    std::vector<Position> positions = testPositions(geometry, count);
+    TranspositionTable table(megabytes);
+
+    printf("%d positions, depth %d, %zu MB table\n", count, depth, table.megabytes());
+
+    if (evalMode) {
+        evalKernels(geometry, positions);
+    }
+    else if (scalingMode) {
+        scaling(geometry, positions, depth, table);
+    }
+    else {
+        compareTable(geometry, positions, depth, table);
+    }
+    return 0;
+}
@@ -0,0 +1,146 @@
+// Opening book builder.
+//
+// Usage: shax-book [--games N] [--depth N] [--random-plies N] [--min-games N] [--out FILE]
+//
+// Plays the engine against itself on the standard board and keeps every
+// placement phase move of the games, weighted by how they turned out for the
+// player that made it (2 per win, 1 per draw). The first few moves of each
+// game are random so the games don't all repeat the same line. Moves played
+// in fewer than --min-games games are left out.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <random>
+#include <utility>
+#include <vector>
+#include "rules/search.h"
+#include "rules/openingbook.h"
+
+using namespace Rules;
+
+namespace {
+
+// Games still going after this many moves are drawn
+const int MAX_GAME_PLIES = 300;
+
+struct MoveStats {
+    uint32_t games = 0;
+    uint32_t points = 0;
+};
+
+struct BookMove {
+    uint64_t key;
+    Move move;
+    int side;
+};
+
+} // namespace
+
+int main(int argc, char *argv[]){
+    int games = 200;
+    int depth = 6;
+    int randomPlies = 2;
+    uint32_t minGames = 2;
+    std::string path = "book.shbk";
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--games") && i + 1 < argc)
+            games = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--depth") && i + 1 < argc)
+            depth = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--random-plies") && i + 1 < argc)
+            randomPlies = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--min-games") && i + 1 < argc)
+            minGames = (uint32_t)atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--out") && i + 1 < argc)
+            path = argv[++i];
+        else {
+            fprintf(stderr, "Usage: %s [--games N] [--depth N] [--random-plies N] [--min-games N] [--out FILE]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    Geometry geometry = Geometry::standard();
+    TranspositionTable table(64);
+    std::mt19937 random(2024);
+    std::map<std::pair<uint64_t, uint16_t>, MoveStats> stats;
+    int wins[2] = {0, 0};
+
+    SearchLimits limits;
+    limits.maxDepth = depth;
+    limits.timeMs = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    for (int game = 0; game < games; game++) {
+        Position position = Position::start(geometry);
+        std::vector<BookMove> played;
+
+        for (int ply = 0; ply < MAX_GAME_PLIES && position.phase != Phase::Over; ply++) {
+            Move move;
+            if (ply < randomPlies) {
+                MoveList moves;
+                generateMoves(geometry, position, moves);
+                move = moves[random() % moves.size()];
+            }
+            else {
+                Search search(geometry, &table);
+                move = search.run(position, limits).best;
+            }
+
+            if (position.phase == Phase::Placement) {
+                played.push_back({position.key, move, position.side});
+            }
+            position = play(geometry, position, move);
+        }
+
+        int winner = position.phase == Phase::Over ? position.winner : -1;
+        if (winner >= 0) {
+            wins[winner]++;
+        }
+
+        for (const BookMove &move : played) {
+            MoveStats &entry = stats[{move.key, move.move.raw()}];
+            entry.games++;
+            entry.points += winner < 0 ? 1 : winner == move.side ? 2 : 0;
+        }
+
+        if ((game + 1) % 10 == 0) {
+            printf("%d games, player 1 won %d, player 2 won %d\n", game + 1, wins[0], wins[1]);
+        }
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    // The map is already in key then move order
+    std::vector<OpeningBook::Entry> entries;
+    for (const auto &[key, entry] : stats) {
+        if (entry.games < minGames || entry.points == 0)
+            continue;
+        entries.push_back({key.first, key.second, (uint16_t)std::min<uint32_t>(entry.points, UINT16_MAX), 0});
+    }
+
+    FILE *file = fopen(path.c_str(), "wb");
+    if (!file) {
+        fprintf(stderr, "Couldn't open %s\n", path.c_str());
+        return 1;
+    }
+
+    OpeningBook::Header header = {};
+    memcpy(header.magic, OpeningBook::MAGIC, sizeof(header.magic));
+    header.geometryKey = geometry.key();
+    header.entries = entries.size();
+
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1
+           && fwrite(entries.data(), sizeof(OpeningBook::Entry), entries.size(), file) == entries.size();
+    ok = fclose(file) == 0 && ok;
+    if (!ok) {
+        fprintf(stderr, "Couldn't write %s\n", path.c_str());
+        return 1;
+    }
+
+    printf("%zu entries from %zu moves in %d games (%.1f s), written to %s\n", entries.size(), stats.size(), games, seconds, path.c_str());
+    return 0;
+}
@@ -0,0 +1,357 @@
+// Paint benchmark of a full board.
+//
+// Usage: shax-paintbench [--frames N] [--ratio R] [--profile FILE] [--trace FILE]
+//
+// Lays out the standard board the way the client does, with a piece on
+// every node, some of them highlighted. The animation scheduler's tick cost
+// for the drop-in of all of them is logged. Once the pieces have dropped in,
+// the whole scene is rendered into an image --frames times (default 300),
+// first with the board and pieces drawn directly and then from their
+// cached pixmaps. That's done at the device pixel ratio given, or at 1 and 2.
+// A frame of each is also compared pixel by pixel, the cache should look the
+// same as drawing directly. The strip down the right side that widening the
+// window exposes is timed the same way.
+//
+// Before that, clicks are checked to land on the right node now that the
+// board resolves them by position: on a node but off its piece, between
+// nodes, and through the scene the way a press is delivered.
+//
+// With --profile, the scene is also shown in a view with the profiler
+// overlay, the way the client's debug menu does it. The view and the
+// overlay are repainted PROFILE_FRAMES times and every repaint has to make
+// exactly one frame, begun and ended in order. The frames are written to
+// FILE like the client's "Export render profile".
+//
+// With --trace, the timed renders are traced and written to FILE as trace
+// event JSON, which is read back to check that it parses.
+//
+// It needs no display, without one it runs on the offscreen platform.
+
+#include <QApplication>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QGraphicsScene>
+#include <QGraphicsView>
+#include <QImage>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QFile>
+#include <QPainter>
+#include <QPair>
+#include <QTimer>
+#include <QDebug>
+#include "gamepiece.h"
+#include "boarditem.h"
+#include "spritecache.h"
+#include "animationscheduler.h"
+#include "renderprofiler.h"
+#include "tracer.h"
+#include "../gui/profileroverlay.h"
+#include "rules/geometry.h"
+
+namespace {
+
+// Same look as the client's board
+const float RADIUS = 15;
+const float PEN_WIDTH = 3;
+const float GRID_SPACING = 70;
+const QColor PLAYER_COLORS[2] = {QColor(140, 75, 50), QColor(50, 50, 50)};
+const QColor LINES_COLOR = QColor(127, 92, 38);
+const QBrush NODES_BRUSH = QBrush(QColor(200, 180, 150));
+const int NODES_BORDER_THICKNESS = 2;
+
+// Repaints checked with --profile
+const int PROFILE_FRAMES = 600;
+
+BoardItem *buildBoard(QGraphicsScene &scene){
+    const Rules::Geometry geometry = Rules::Geometry::standard();
+    BoardTopology topology;
+
+    for (int node = 0; node < geometry.nodeCount(); node++) {
+        Rules::Point p = geometry.point(node);
+        QList<QPoint> &neighbors = topology[QPoint(p.x, p.y)];
+        for (Rules::Bitboard b = geometry.adjacent(node); b;) {
+            Rules::Point q = geometry.point(Rules::popLowest(b));
+            neighbors.append(QPoint(q.x, q.y));
+        }
+    }
+
+    QPen linesPen(LINES_COLOR, PEN_WIDTH);
+    QPen nodesPen(LINES_COLOR, NODES_BORDER_THICKNESS);
+    BoardItem *board = new BoardItem(topology, GRID_SPACING, RADIUS, linesPen, nodesPen, NODES_BRUSH);
+    scene.addItem(board);
+
+    // A piece on every node, as after placement. A third of them are
+    // highlighted as movable and a third as removable.
+    for (int node = 0; node < geometry.nodeCount(); node++) {
+        Rules::Point p = geometry.point(node);
+        GamePiece *piece = new GamePiece(node, p.x * GRID_SPACING, p.y * GRID_SPACING, RADIUS, PLAYER_COLORS[node & 1]);
+        if (node % 3 == 1)
+            piece->activate(true);
+        else if (node % 3 == 2)
+            piece->activate(false);
+        scene.addItem(piece);
+    }
+    return board;
+}
+
+// Number of clicks that didn't land where they should
+int checkHits(QGraphicsScene &scene, BoardItem *board){
+    const Rules::Geometry geometry = Rules::Geometry::standard();
+    const QPoint none(-1, -1);
+    int checks = 0, failures = 0;
+
+    auto check = [&](bool ok, const char *what, QPoint node) {
+        checks++;
+        if (!ok) {
+            failures++;
+            qWarning() << "Hit test failed:" << what << "at node" << node;
+        }
+    };
+
+    for (int node = 0; node < geometry.nodeCount(); node++) {
+        Rules::Point p = geometry.point(node);
+        const QPoint boardPos(p.x, p.y);
+        const QPointF center = QPointF(boardPos) * GRID_SPACING;
+
+        check(board->nodeAt(board->mapFromScene(center)) == boardPos, "center", boardPos);
+
+        // Inside the node's ring but outside the smaller piece, the press
+        // goes past the piece to the board
+        const QPointF ring = center + QPointF(RADIUS - 2, 0);
+        check(board->nodeAt(board->mapFromScene(ring)) == boardPos, "ring", boardPos);
+        const QList<QGraphicsItem *> atRing = scene.items(ring);
+        check(!atRing.isEmpty() && atRing.first() == board, "ring through the scene", boardPos);
+
+        // The piece is on top at the center
+        const QList<QGraphicsItem *> atCenter = scene.items(center);
+        check(!atCenter.isEmpty() && dynamic_cast<GamePiece *>(atCenter.first()) != nullptr,
+              "piece through the scene", boardPos);
+
+        // Just off the node in each direction
+        for (QPointF offset : {QPointF(RADIUS + 2, 0), QPointF(-RADIUS - 2, 0), QPointF(0, RADIUS + 2), QPointF(0, -RADIUS - 2)}) {
+            check(board->nodeAt(board->mapFromScene(center + offset)) == none, "outside", boardPos);
+        }
+    }
+
+    qDebug().nospace() << "Hit tests: " << checks - failures << "/" << checks << " passed";
+    return failures;
+}
+
+void renderFrame(QGraphicsScene &scene, QImage &image, const QRectF &sceneRect){
+    image.fill(Qt::white);
+    QPainter painter(&image);
+    painter.setRenderHints(QPainter::Antialiasing | QPainter::SmoothPixmapTransform);
+    scene.render(&painter, QRectF(QPointF(0, 0), sceneRect.size()), sceneRect);
+}
+
+QImage sceneImage(QGraphicsScene &scene, qreal pixelRatio){
+    const QRectF sceneRect = scene.itemsBoundingRect();
+    QImage image((sceneRect.size() * pixelRatio).toSize(), QImage::Format_ARGB32_Premultiplied);
+    image.setDevicePixelRatio(pixelRatio);
+    renderFrame(scene, image, sceneRect);
+    return image;
+}
+
+// Average time to render the whole scene, or part of it, in us
+double renderTime(QGraphicsScene &scene, qreal pixelRatio, int frames, QRectF sceneRect = QRectF()){
+    if (sceneRect.isNull())
+        sceneRect = scene.itemsBoundingRect();
+    QImage image((sceneRect.size() * pixelRatio).toSize(), QImage::Format_ARGB32_Premultiplied);
+    image.setDevicePixelRatio(pixelRatio);
+
+    QElapsedTimer timer;
+    timer.start();
+    for (int frame = 0; frame < frames; frame++) {
+        renderFrame(scene, image, sceneRect);
+    }
+    return timer.nsecsElapsed() / 1000.0 / frames;
+}
+
+// Pixels that differ by more than a step of antialiasing, and the largest
+// difference in any channel
+QPair<int, int> compareImages(const QImage &a, const QImage &b){
+    int differing = 0, maxDiff = 0;
+    for (int y = 0; y < qMin(a.height(), b.height()); y++) {
+        const QRgb *lineA = reinterpret_cast<const QRgb *>(a.constScanLine(y));
+        const QRgb *lineB = reinterpret_cast<const QRgb *>(b.constScanLine(y));
+        for (int x = 0; x < qMin(a.width(), b.width()); x++) {
+            int diff = qMax(qMax(qAbs(qRed(lineA[x]) - qRed(lineB[x])), qAbs(qGreen(lineA[x]) - qGreen(lineB[x]))),
+                            qMax(qAbs(qBlue(lineA[x]) - qBlue(lineB[x])), qAbs(qAlpha(lineA[x]) - qAlpha(lineB[x]))));
+            maxDiff = qMax(maxDiff, diff);
+            if (diff > 8)
+                differing++;
+        }
+    }
+    return {differing, maxDiff};
+}
+
+// Repaints the scene in a view with the profiler overlay and checks that
+// each repaint is one frame. Returns the number of problems found.
+int checkProfile(QGraphicsScene &scene, const QString &fileName){
+    QGraphicsView view(&scene);
+    view.resize(800, 600);
+    ProfilerOverlay *overlay = new ProfilerOverlay(&view);
+    view.show();
+    QCoreApplication::processEvents();
+
+    // Only the repaints below are counted
+    overlay->setActive(true);
+    RenderProfiler::clear();
+
+    // The view is repainted when the board changes, the overlay on its own
+    // when its refresh timer fires. Both have to begin and end a frame.
+    for (int i = 0; i < PROFILE_FRAMES; i++) {
+        if (i % 2 == 0)
+            view.viewport()->repaint();
+        else
+            overlay->repaint();
+    }
+
+    int failures = 0;
+    if (RenderProfiler::frameCount() != PROFILE_FRAMES) {
+        qWarning() << "Profiled" << RenderProfiler::frameCount() << "frames for" << PROFILE_FRAMES << "repaints";
+        failures++;
+    }
+    if (RenderProfiler::unmatchedFrames() > 0) {
+        qWarning() << RenderProfiler::unmatchedFrames() << "frames began or ended out of order";
+        failures++;
+    }
+    if (!RenderProfiler::dump(fileName)) {
+        qWarning() << "Couldn't write" << fileName;
+        failures++;
+    }
+    else {
+        qDebug() << "Render profile of" << RenderProfiler::frameCount() << "frames written to" << fileName;
+    }
+
+    overlay->setActive(false);
+    return failures;
+}
+
+// Writes the trace and reads it back. Returns the number of problems found.
+int checkTrace(const QString &fileName){
+    Tracer::setEnabled(false);
+    const int events = Tracer::dump(fileName);
+    Tracer::clear();
+    if (events <= 0) {
+        qWarning() << "Couldn't write a trace to" << fileName;
+        return 1;
+    }
+
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        qWarning() << "Couldn't read" << fileName << "back";
+        return 1;
+    }
+    QJsonParseError error;
+    const QJsonDocument json = QJsonDocument::fromJson(file.readAll(), &error);
+    if (error.error != QJsonParseError::NoError) {
+        qWarning() << "The trace isn't valid JSON:" << error.errorString() << "at" << error.offset;
+        return 1;
+    }
+
+    // Thread and process names come before the events
+    const QJsonArray traceEvents = json.object().value("traceEvents").toArray();
+    int spans = 0;
+    for (const QJsonValue &event : traceEvents) {
+        if (event.toObject().value("ph").toString() == "X")
+            spans++;
+    }
+    if (spans != events) {
+        qWarning() << "The trace has" << spans << "events, dump wrote" << events;
+        return 1;
+    }
+    qDebug() << "Trace of" << events << "events written to" << fileName;
+    return 0;
+}
+
+} // namespace
+
+int main(int argc, char *argv[]){
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM") && qEnvironmentVariableIsEmpty("DISPLAY")
+        && qEnvironmentVariableIsEmpty("WAYLAND_DISPLAY")) {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+    QApplication app(argc, argv);
+
+    int frames = 300;
+    QList<qreal> pixelRatios = {1, 2};
+    QString profileFile;
+    QString traceFile;
+
+    QStringList args = app.arguments();
+    for (int i = 1; i < args.size(); i++) {
+        if (args[i] == "--frames" && i + 1 < args.size())
+            frames = qMax(1, args[++i].toInt());
+        else if (args[i] == "--ratio" && i + 1 < args.size())
+            pixelRatios = {args[++i].toDouble()};
+        else if (args[i] == "--profile" && i + 1 < args.size())
+            profileFile = args[++i];
+        else if (args[i] == "--trace" && i + 1 < args.size())
+            traceFile = args[++i];
+        else {
+            qWarning().noquote() << "Usage:" << args[0] << "[--frames N] [--ratio R] [--profile FILE] [--trace FILE]";
+            return 1;
+        }
+    }
+
+    // Logs the cost of the scheduler's ticks once the pieces have dropped in
+    AnimationScheduler::instance()->setReporting(true);
+
+    QGraphicsScene scene;
+    scene.setItemIndexMethod(QGraphicsScene::NoIndex);
+    BoardItem *board = buildBoard(scene);
+    qDebug() << "Scene items:" << scene.items().size();
+
+    // Let the drop-in animations finish, pieces are drawn scaled until then
+    QEventLoop loop;
+    QTimer::singleShot(1000, &loop, &QEventLoop::quit);
+    loop.exec();
+
+    if (AnimationScheduler::instance()->activeTweens() > 0) {
+        qWarning() << "Animations still running after the drop-in:" << AnimationScheduler::instance()->activeTweens();
+        return 1;
+    }
+
+    int failures = checkHits(scene, board);
+
+    if (!traceFile.isEmpty()) {
+        Tracer::setEnabled(true);
+    }
+
+    QRectF strip = scene.itemsBoundingRect();
+    strip.setLeft(strip.right() - GRID_SPACING);
+
+    for (qreal pixelRatio : std::as_const(pixelRatios)) {
+        SpriteCache::setEnabled(false);
+        const QImage directImage = sceneImage(scene, pixelRatio);
+        double direct = renderTime(scene, pixelRatio, frames);
+        double directStrip = renderTime(scene, pixelRatio, frames, strip);
+
+        // The first frame fills the cache, it's left out
+        SpriteCache::setEnabled(true);
+        SpriteCache::clear();
+        const QImage cachedImage = sceneImage(scene, pixelRatio);
+        double cached = renderTime(scene, pixelRatio, frames);
+        double cachedStrip = renderTime(scene, pixelRatio, frames, strip);
+
+        const QPair<int, int> diff = compareImages(directImage, cachedImage);
+
+        qDebug().nospace() << "Pixel ratio " << pixelRatio << ": direct " << qRound(direct) << "us/frame, cached "
+                           << qRound(cached) << "us/frame (" << SpriteCache::size() << " sprites), "
+                           << QString::number(direct / cached, 'f', 2) << "x faster, "
+                           << diff.first << " pixels differ (max " << diff.second << "/255)";
+        qDebug().nospace() << "Pixel ratio " << pixelRatio << ", exposed strip: direct " << qRound(directStrip)
+                           << "us, cached " << qRound(cachedStrip) << "us";
+    }
+
+    if (!traceFile.isEmpty()) {
+        failures += checkTrace(traceFile);
+    }
+    if (!profileFile.isEmpty()) {
+        failures += checkProfile(scene, profileFile);
+    }
+    return failures > 0 ? 1 : 0;
+}
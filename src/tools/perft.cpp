@@ -0,0 +1,251 @@
+// Move generator check and benchmark.
+//
+// Usage: shax-perft [--threads N] [--depth N] [--position "..."] [--divide]
+//
+// Without --position, counts the leaf nodes of every position of the suite
+// below to each depth it has reference counts for, reports nodes/s, and
+// exits with 1 if any count differs from its reference.
+// With --position, counts that position to --depth (default 5); --divide
+// also prints the count under each root move.
+//
+// Every move counts as a ply, including removals. Positions are written as
+//   <nodes> <side to move> <phase> <in hand 0> <in hand 1> <first mill>
+// where <nodes> has one character per node in the board's canonical order
+// (x for player 0, o for player 1, . for empty), the phase is one of
+// P, F, R, M (placement, first removal, removal, movement), and the first
+// mill is the player that made it or -1.
+//
+// The root moves are split between threads.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "rules/position.h"
+
+using namespace Rules;
+
+namespace {
+
+struct SuitePosition {
+    const char *name;
+    const char *position;
+    // Leaf counts at depth 1, 2, ...
+    std::vector<uint64_t> counts;
+};
+
+// Counts on the standard board. The placement ones can be checked by hand,
+// they're every ordered way to fill the empty nodes (24, 24*23, ...).
+// The others were taken from the generator once it passed those and are
+// there to catch changes.
+const SuitePosition SUITE[] = {
+    {"start", "........................ 0 P 12 12 -1",
+        {24, 552, 12144, 255024, 5100480, 96909120}},
+    {"placement", "oo.x..x..ooo.x.xxx...... 1 P 6 7 1",
+        {13, 156, 1716, 17160, 154440, 1235520, 8648640, 51891840}},
+    {"first removal", "oxoxxxooxxxooxooxooxooxx 1 F 0 0 1",
+        {6, 7, 10, 10, 9, 12, 19, 22, 53, 182, 647, 2915, 11242, 54827, 262482, 1313364}},
+    {"movement", "oxoxxxoox.xooxooxooxooxx 0 M 0 0 1",
+        {1, 2, 1, 1, 2, 11, 16, 50, 180, 645, 2914, 11241, 54827, 262482, 1313364, 7335433}},
+    {"removal", "x.ooooxxoxooxxoxooxoxxxo 1 R 0 0 1",
+        {6, 13, 46, 109, 463, 1961, 7726, 37509, 182448, 931954, 5289865, 29132629}},
+    {"late movement", "..ooxo..o.x..x.x..xx.x.x 1 M 0 0 0",
+        {6, 101, 622, 8731, 60881, 760802, 6094093, 71021496}},
+};
+
+bool parsePosition(const Geometry &geometry, const std::string &text, Position &position, std::string &error){
+    std::istringstream in(text);
+    std::string nodes, phase;
+    int side, hand0, hand1, firstJare;
+
+    if (!(in >> nodes >> side >> phase >> hand0 >> hand1 >> firstJare)) {
+        error = "expected 6 fields";
+        return false;
+    }
+    if ((int)nodes.size() != geometry.nodeCount()) {
+        error = "expected " + std::to_string(geometry.nodeCount()) + " nodes";
+        return false;
+    }
+
+    position = Position();
+    for (int node = 0; node < geometry.nodeCount(); node++) {
+        if (nodes[node] == 'x')
+            position.pieces[0] |= bitOf(node);
+        else if (nodes[node] == 'o')
+            position.pieces[1] |= bitOf(node);
+        else if (nodes[node] != '.') {
+            error = std::string("unknown node '") + nodes[node] + "'";
+            return false;
+        }
+    }
+
+    const std::string phases = "PFRM";
+    if (phase.size() != 1 || phases.find(phase[0]) == std::string::npos) {
+        error = "unknown phase " + phase;
+        return false;
+    }
+
+    position.phase = (Phase)phases.find(phase[0]);
+    position.side = (uint8_t)(side & 1);
+    position.inHand[0] = (uint8_t)hand0;
+    position.inHand[1] = (uint8_t)hand1;
+    position.firstJare = (int8_t)firstJare;
+    position.rehash();
+    return true;
+}
+
+uint64_t perft(const Geometry &geometry, const Position &position, int depth){
+    if (depth == 0) {
+        return 1;
+    }
+
+    MoveList moves;
+    generateMoves(geometry, position, moves);
+
+    // Leaves don't need to be played
+    if (depth == 1) {
+        return moves.size();
+    }
+
+    uint64_t nodes = 0;
+    for (Move move : moves) {
+        nodes += perft(geometry, play(geometry, position, move), depth - 1);
+    }
+    return nodes;
+}
+
+// Counts under each root move, the moves are shared out between threads
+std::vector<uint64_t> splitPerft(const Geometry &geometry, const Position &position, int depth, int threadCount, MoveList &moves){
+    moves.clear();
+    generateMoves(geometry, position, moves);
+    std::vector<uint64_t> counts(moves.size(), 0);
+    if (depth == 0) {
+        return counts;
+    }
+
+    std::atomic<int> next{0};
+    auto work = [&]{
+        for (int i = next++; i < moves.size(); i = next++) {
+            counts[i] = perft(geometry, play(geometry, position, moves[i]), depth - 1);
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (int i = 1; i < threadCount; i++) {
+        threads.emplace_back(work);
+    }
+    work();
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+    return counts;
+}
+
+std::string moveName(const Geometry &geometry, Move move){
+    auto name = [&](int node){
+        Point p = geometry.point(node);
+        return "(" + std::to_string(p.x) + "," + std::to_string(p.y) + ")";
+    };
+
+    switch (move.type()) {
+        case Move::Place:
+            return "place " + name(move.to());
+        case Move::Remove:
+            return "remove " + name(move.from());
+        case Move::Slide:
+            return "slide " + name(move.from()) + "-" + name(move.to());
+        case Move::None:
+            break;
+    }
+    return "none";
+}
+
+} // namespace
+
+int main(int argc, char *argv[]){
+    int threads = (int)std::max(1u, std::thread::hardware_concurrency());
+    int depth = 5;
+    bool divide = false;
+    std::string text;
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--threads") && i + 1 < argc)
+            threads = std::max(1, atoi(argv[++i]));
+        else if (!strcmp(argv[i], "--depth") && i + 1 < argc)
+            depth = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--position") && i + 1 < argc)
+            text = argv[++i];
+        else if (!strcmp(argv[i], "--divide"))
+            divide = true;
+        else {
+            fprintf(stderr, "Usage: %s [--threads N] [--depth N] [--position \"...\"] [--divide]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    Geometry geometry = Geometry::standard();
+    std::string error;
+    MoveList moves;
+
+    if (!text.empty()) {
+        Position position;
+        if (!parsePosition(geometry, text, position, error)) {
+            fprintf(stderr, "Bad position: %s\n", error.c_str());
+            return 1;
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        std::vector<uint64_t> counts = splitPerft(geometry, position, depth, threads, moves);
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        uint64_t total = 0;
+        for (int i = 0; i < moves.size(); i++) {
+            if (divide)
+                printf("%-24s %llu\n", moveName(geometry, moves[i]).c_str(), (unsigned long long)counts[i]);
+            total += counts[i];
+        }
+        printf("perft(%d) = %llu in %.3f s, %.0f nodes/s\n", depth, (unsigned long long)total, seconds, total / seconds);
+        return 0;
+    }
+
+    bool passed = true;
+    uint64_t allNodes = 0;
+    double allSeconds = 0;
+
+    for (const SuitePosition &entry : SUITE) {
+        Position position;
+        if (!parsePosition(geometry, entry.position, position, error)) {
+            fprintf(stderr, "Bad suite position %s: %s\n", entry.name, error.c_str());
+            return 1;
+        }
+
+        for (int d = 1; d <= (int)entry.counts.size(); d++) {
+            auto start = std::chrono::steady_clock::now();
+            uint64_t total = 0;
+            for (uint64_t count : splitPerft(geometry, position, d, threads, moves)) {
+                total += count;
+            }
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+            bool ok = total == entry.counts[d - 1];
+            passed = passed && ok;
+            allNodes += total;
+            allSeconds += seconds;
+
+            printf("%-14s perft(%d) = %12llu  %s", entry.name, d, (unsigned long long)total, ok ? "ok" : "MISMATCH");
+            if (!ok)
+                printf(" (expected %llu)", (unsigned long long)entry.counts[d - 1]);
+            printf("  %.3f s\n", seconds);
+        }
+    }
+
+    printf("%llu nodes in %.3f s with %d threads, %.0f nodes/s\n", (unsigned long long)allNodes, allSeconds, threads, allNodes / allSeconds);
+    printf("%s\n", passed ? "All counts match" : "Some counts don't match");
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,313 @@
+// Endgame tablebase generator for the movement phase.
+//
+// Usage: shax-tbgen [--max-pieces N] [--threads N] [--out DIR]
+//
+// Builds every table of the standard board with at most N pieces in total
+// (7 by default) by retrograde analysis, in rounds: round n finds the
+// positions whose game ends in exactly n moves with best play, from the
+// results of the rounds before it. Positions still open when no round finds
+// anything new are draws. Material balances are solved from the fewest
+// pieces up, since a removal leads into a smaller table.
+//
+// Each round is split across threads by position index.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "rules/tablebase.h"
+
+using namespace Rules;
+
+namespace {
+
+const int MAX_PLIES = 254;
+
+struct Table {
+    int us = 0;
+    int them = 0;
+    uint64_t size = 0;
+    // Results up to the last round, and the ones of the round being run
+    std::vector<uint8_t> current;
+    std::vector<uint8_t> next;
+};
+
+class Generator
+{
+public:
+    Generator(const Geometry &geometry, int threads)
+        : geometry(geometry), nodes(geometry.nodeCount()), threadCount(threads)
+    {
+    }
+
+    void solve(int maxPieces, const std::string &directory);
+
+private:
+    const Geometry &geometry;
+    const int nodes;
+    const int threadCount;
+    std::unique_ptr<Table> tables[Tablebase::MAX_PIECES + 1][Tablebase::MAX_PIECES + 1];
+
+    void solveGroup(const std::vector<Table *> &group, int longestBefore);
+    uint8_t solvePosition(const Table &table, Bitboard us, Bitboard them, int round) const;
+    uint64_t runRound(Table &table, int round);
+    bool write(const Table &table, const std::string &directory) const;
+};
+
+// Round 0 finds the blocked positions, round n > 0 the ones decided in n moves.
+// Returns the value of the position, or 0 while it's still open.
+uint8_t Generator::solvePosition(const Table &table, Bitboard us, Bitboard them, int round) const{
+    const Bitboard empty = geometry.allNodes() & ~(us | them);
+    bool anyMove = false;
+    bool allLost = true;
+    int quickestWin = MAX_PLIES + 1;
+    int slowestLoss = 0;
+
+    // Children are seen from the opponent's side: an even number of moves
+    // left means they lose, so the move wins for us
+    auto consider = [&](uint8_t child){
+        if (child == 0) {
+            allLost = false;
+            return;
+        }
+
+        int plies = child - 1;
+        if (plies % 2 == 0) {
+            allLost = false;
+            quickestWin = std::min(quickestWin, plies);
+        }
+        else {
+            slowestLoss = std::max(slowestLoss, plies);
+        }
+    };
+
+    for (Bitboard own = us; own;) {
+        int from = popLowest(own);
+        for (Bitboard targets = geometry.adjacent(from) & empty; targets;) {
+            int to = popLowest(targets);
+            anyMove = true;
+            if (round == 0) {
+                return 0;
+            }
+
+            Bitboard moved = us ^ bitOf(from) ^ bitOf(to);
+            if (!geometry.formsMill(moved, to)) {
+                const Table &after = *tables[table.them][table.us];
+                consider(after.current[Tablebase::indexOf(nodes, them, moved)]);
+                continue;
+            }
+
+            // A mill: every removal is a move of its own
+            Bitboard removable = them & ~geometry.inMills(them);
+            for (Bitboard targets = removable ? removable : them; targets;) {
+                Bitboard left = them & ~bitOf(popLowest(targets));
+                if (popCount(left) < Tablebase::MIN_PIECES) {
+                    consider(1);
+                    continue;
+                }
+
+                const Table &after = *tables[table.them - 1][table.us];
+                consider(after.current[Tablebase::indexOf(nodes, left, moved)]);
+            }
+        }
+    }
+
+    // A player that can't move has lost
+    if (!anyMove) {
+        return 1;
+    }
+
+    // Only take results from earlier rounds, so each round adds exactly one move
+    if (quickestWin <= round - 1) {
+        return (uint8_t)(quickestWin + 2);
+    }
+    if (allLost && slowestLoss <= round - 1) {
+        return (uint8_t)(slowestLoss + 2);
+    }
+    return 0;
+}
+
+uint64_t Generator::runRound(Table &table, int round){
+    const uint64_t CHUNK = 4096;
+    std::atomic<uint64_t> nextChunk{0};
+    std::atomic<uint64_t> solved{0};
+
+    auto work = [&]{
+        uint64_t found = 0;
+        for (;;) {
+            uint64_t begin = nextChunk.fetch_add(CHUNK);
+            if (begin >= table.size)
+                break;
+            uint64_t end = std::min(begin + CHUNK, table.size);
+
+            for (uint64_t i = begin; i < end; i++) {
+                if (table.current[i] != 0)
+                    continue;
+
+                Bitboard us, them;
+                Tablebase::positionAt(nodes, table.us, table.them, i, us, them);
+                uint8_t value = solvePosition(table, us, them, round);
+                if (value != 0) {
+                    table.next[i] = value;
+                    found++;
+                }
+            }
+        }
+        solved += found;
+    };
+
+    std::vector<std::thread> threads;
+    for (int i = 1; i < threadCount; i++) {
+        threads.emplace_back(work);
+    }
+    work();
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+    return solved;
+}
+
+// Tables with the same number of pieces lead into each other and are solved together
+void Generator::solveGroup(const std::vector<Table *> &group, int longestBefore){
+    for (int round = 0; round <= MAX_PLIES; round++) {
+        uint64_t solved = 0;
+        for (Table *table : group) {
+            solved += runRound(*table, round);
+        }
+        for (Table *table : group) {
+            table->current = table->next;
+        }
+
+        // Smaller tables can still make positions decided in up to longestBefore + 1 moves
+        if (round > 0 && solved == 0 && round > longestBefore + 1) {
+            return;
+        }
+    }
+
+    fprintf(stderr, "Some positions take more than %d moves, they're left as draws\n", MAX_PLIES);
+}
+
+bool Generator::write(const Table &table, const std::string &directory) const{
+    std::string path = directory + "/" + Tablebase::fileName(table.us, table.them);
+    FILE *file = fopen(path.c_str(), "wb");
+    if (!file) {
+        fprintf(stderr, "Couldn't open %s\n", path.c_str());
+        return false;
+    }
+
+    Tablebase::Header header = {};
+    memcpy(header.magic, Tablebase::MAGIC, sizeof(header.magic));
+    header.geometryKey = geometry.key();
+    header.nodes = (uint8_t)nodes;
+    header.us = (uint8_t)table.us;
+    header.them = (uint8_t)table.them;
+    header.positions = table.size;
+
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1
+           && fwrite(table.current.data(), 1, table.size, file) == table.size;
+    ok = fclose(file) == 0 && ok;
+    if (!ok) {
+        fprintf(stderr, "Couldn't write %s\n", path.c_str());
+    }
+    return ok;
+}
+
+void Generator::solve(int maxPieces, const std::string &directory){
+    const int most = std::min(geometry.piecesPerPlayer(), (int)Tablebase::MAX_PIECES);
+    int longest = 0;
+
+    for (int total = 2 * Tablebase::MIN_PIECES; total <= maxPieces && total <= nodes; total++) {
+        std::vector<Table *> group;
+        for (int us = Tablebase::MIN_PIECES; us <= most; us++) {
+            int them = total - us;
+            if (them < Tablebase::MIN_PIECES || them > most)
+                continue;
+
+            auto table = std::make_unique<Table>();
+            table->us = us;
+            table->them = them;
+            table->size = Tablebase::tableSize(nodes, us, them);
+            table->current.assign(table->size, 0);
+            table->next.assign(table->size, 0);
+            group.push_back(table.get());
+            tables[us][them] = std::move(table);
+        }
+        if (group.empty()) {
+            continue;
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        solveGroup(group, longest);
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        for (Table *table : group) {
+            uint64_t wins = 0, losses = 0, draws = 0;
+            int tableLongest = 0;
+            for (uint8_t value : table->current) {
+                TablebaseResult result = Tablebase::decode(value);
+                if (result.outcome > 0)
+                    wins++;
+                else if (result.outcome < 0)
+                    losses++;
+                else
+                    draws++;
+                tableLongest = std::max(tableLongest, result.plies);
+            }
+            longest = std::max(longest, tableLongest);
+
+            // The next round of tables only needs these, the big buffers can go
+            table->next.clear();
+            table->next.shrink_to_fit();
+
+            printf("%s: %llu positions, %llu won, %llu lost, %llu drawn, longest %d moves\n",
+                   Tablebase::fileName(table->us, table->them).c_str(), (unsigned long long)table->size,
+                   (unsigned long long)wins, (unsigned long long)losses, (unsigned long long)draws, tableLongest);
+            write(*table, directory);
+        }
+        printf("%d pieces solved in %.1f s\n", total, seconds);
+
+        // Tables a piece smaller were only needed by this group
+        for (int us = Tablebase::MIN_PIECES; us <= most; us++) {
+            int them = total - 1 - us;
+            if (them >= Tablebase::MIN_PIECES && them <= most)
+                tables[us][them].reset();
+        }
+    }
+}
+
+} // namespace
+
+int main(int argc, char *argv[]){
+    int maxPieces = 7;
+    int threads = (int)std::max(1u, std::thread::hardware_concurrency());
+    std::string directory = "tablebases";
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--max-pieces") && i + 1 < argc)
+            maxPieces = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--threads") && i + 1 < argc)
+            threads = std::max(1, atoi(argv[++i]));
+        else if (!strcmp(argv[i], "--out") && i + 1 < argc)
+            directory = argv[++i];
+        else {
+            fprintf(stderr, "Usage: %s [--max-pieces N] [--threads N] [--out DIR]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    std::error_code error;
+    std::filesystem::create_directories(directory, error);
+
+    Geometry geometry = Geometry::standard();
+    printf("Generating tables of up to %d pieces with %d threads into %s\n", maxPieces, threads, directory.c_str());
+
+    Generator generator(geometry, threads);
+    generator.solve(maxPieces, directory);
+    return 0;
+}